@@ -0,0 +1,795 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <numeric>
+#include <cstdlib>
+#include <memory>
+#include <atomic>
+#include <new>
+
+#include "opencv2/opencv.hpp"
+#include "MultiVideoCapture.hpp"
+#include "FaultInjectingCapture.hpp"
+#include "StaticMultiVideoCapture.hpp"
+#include "FrameServer.hpp"
+#include "FrameClient.hpp"
+#include "TensorStage.hpp"
+#include "LazyFrameSet.hpp"
+#include "AlignedAlloc.hpp"
+
+
+// a video file played as a live camera, looping and paced at the sensor rate (unpaced when fps <= 0).
+class FileCamera : public VideoCaptureType {
+public:
+	FileCamera() {
+		setSource("", 0.f);
+	}
+
+	FileCamera(const std::string& filename, float fps) {
+		setSource(filename, fps);
+	}
+
+	void setSource(const std::string& filename, float fps) {
+		mFile = filename;
+		mPeriod = std::chrono::steady_clock::duration::zero();
+		if (fps > 0.f)
+			mPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+	}
+
+	using VideoCaptureType::open;
+	virtual bool open(int index, int apiPreference) {
+		mCamId = index;
+		mNextFrame = std::chrono::steady_clock::now();
+		return VideoCaptureType::open(mFile);
+	}
+
+	virtual bool grab() {
+		if (mPeriod > std::chrono::steady_clock::duration::zero()) {
+			std::this_thread::sleep_until(mNextFrame);
+			mNextFrame = std::max(mNextFrame + mPeriod, std::chrono::steady_clock::now());
+		}
+
+		if (VideoCaptureType::grab())
+			return true;
+
+		this->seek(0);
+		return VideoCaptureType::grab();
+	}
+
+protected:
+	std::string mFile;
+	std::chrono::steady_clock::duration mPeriod;
+	std::chrono::steady_clock::time_point mNextFrame;
+};
+
+
+// every camera is a FileCamera, the first one gets the faults.
+class BenchCapture : public MultiVideoCapture {
+public:
+	BenchCapture(const std::string& filename, float fps, const FaultProfile& fault)
+		: MultiVideoCapture(false) {
+		mFile = filename;
+		mSensorFps = fps;
+		mFault = fault;
+	}
+
+protected:
+	virtual VideoCaptureType* createCapture(size_t index) {
+		FaultProfile profile = index == 0 ? mFault : FaultProfile();
+		return new FaultInjectingCapture(new FileCamera(mFile, mSensorFps), profile);
+	}
+
+protected:
+	std::string mFile;
+	float mSensorFps;
+	FaultProfile mFault;
+};
+
+
+// a fast camera 0 next to slow ones, paced at their sensor rates.
+class MixedCapture : public MultiVideoCapture {
+public:
+	MixedCapture(const std::string& filename, float fastFps, float slowFps)
+		: MultiVideoCapture(false) {
+		mFile = filename;
+		mFastFps = fastFps;
+		mSlowFps = slowFps;
+	}
+
+protected:
+	virtual VideoCaptureType* createCapture(size_t index) {
+		return new FileCamera(mFile, index == 0 ? mFastFps : mSlowFps);
+	}
+
+protected:
+	std::string mFile;
+	float mFastFps;
+	float mSlowFps;
+};
+
+
+// plain FileCameras, as the sources of the static rig.
+class FileCapture : public MultiVideoCapture {
+public:
+	FileCapture(const std::string& filename)
+		: MultiVideoCapture(false) {
+		mFile = filename;
+	}
+
+protected:
+	virtual VideoCaptureType* createCapture(size_t index) {
+		return new FileCamera(mFile, 0.f);
+	}
+
+protected:
+	std::string mFile;
+};
+
+
+// the rig of the static engine comparison, the video should have this size to avoid resizing.
+const size_t RIG_CAMERAS = 4;
+typedef PixelBgr24<1280, 720> RigFormat;
+
+
+void printRead(const std::string& name, long long reads, double elapsedMsec, double readMaxMsec, unsigned long long grabbed) {
+	std::cout << std::setw(16) << std::left << name
+		<< std::setw(12) << std::left << reads * 1000.0 / elapsedMsec
+		<< std::setw(12) << std::left << elapsedMsec / reads
+		<< std::setw(12) << std::left << readMaxMsec
+		<< std::setw(12) << std::left << grabbed * 1000.0 / elapsedMsec
+		<< std::endl;
+}
+
+
+void benchDynamic(const std::string& filename, double seconds) {
+	std::vector<int> camIds(RIG_CAMERAS);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(RIG_CAMERAS);
+
+	FileCapture mvc(filename);
+	mvc.open(camIds, -1, false);
+
+	typedef std::chrono::duration<double, std::milli> msec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0;
+	double readMaxMsec = 0.0;
+	while (msec(std::chrono::steady_clock::now() - start).count() < seconds * 1000.0) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		mvc >> images;
+		readMaxMsec = std::max(readMaxMsec, msec(std::chrono::steady_clock::now() - t0).count());
+		reads++;
+	}
+	double elapsed = msec(std::chrono::steady_clock::now() - start).count();
+
+	unsigned long long grabbed = 0;
+	for (const auto& camera : mvc.stats()) {
+		grabbed += camera.framesGrabbed;
+	}
+	mvc.release();
+
+	printRead("dynamic", reads, elapsed, readMaxMsec, grabbed);
+}
+
+
+template <class DeliveryPolicy>
+void benchStatic(const std::string& name, const std::string& filename, double seconds) {
+	typedef StaticMultiVideoCapture<RIG_CAMERAS, RigFormat, DeliveryPolicy, FileCamera> Rig;
+	typename Rig::Frames images;
+
+	std::unique_ptr<Rig> rig(new Rig(false));
+	std::array<int, RIG_CAMERAS> camIds;
+	for (size_t i = 0; i < RIG_CAMERAS; i++) {
+		rig->capture(i).setSource(filename, 0.f);
+		camIds[i] = (int)i;
+	}
+	if (!rig->open(camIds)) {
+		std::cout << name << ": the rig could not be opened" << std::endl;
+		return;
+	}
+
+	typedef std::chrono::duration<double, std::milli> msec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0;
+	double readMaxMsec = 0.0;
+	while (msec(std::chrono::steady_clock::now() - start).count() < seconds * 1000.0) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		*rig >> images;
+		readMaxMsec = std::max(readMaxMsec, msec(std::chrono::steady_clock::now() - t0).count());
+		reads++;
+	}
+	double elapsed = msec(std::chrono::steady_clock::now() - start).count();
+
+	unsigned long long grabbed = 0;
+	for (const auto& camera : rig->stats()) {
+		grabbed += camera.framesGrabbed;
+	}
+	rig->release();
+
+	printRead(name, reads, elapsed, readMaxMsec, grabbed);
+}
+
+
+void benchFault(const std::string& name, const std::string& filename, int nbCams, double seconds, const FaultProfile& fault) {
+	const float fps = 30.f;
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+
+	BenchCapture mvc(filename, fps, fault);
+	mvc.open(camIds, -1, true);
+
+	typedef std::chrono::duration<double, std::milli> msec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point downSince;
+	bool down = false;
+	long long framesLost = 0, recoveries = 0, reads = 0, healthyFrames = 0;
+	double recoveryMsec = 0.0, readMsec = 0.0, readMaxMsec = 0.0, healthyAgeMsec = 0.0;
+
+	while (msec(std::chrono::steady_clock::now() - start).count() < seconds * 1000.0) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		mvc >> images;
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+
+		double elapsed = msec(t1 - t0).count();
+		readMsec += elapsed;
+		readMaxMsec = std::max(readMaxMsec, elapsed);
+		reads++;
+
+		// latency of the healthy cameras, from their grab to the consumer.
+		for (int i = 1; i < nbCams; i++) {
+			if (!images[i].empty()) {
+				healthyAgeMsec += std::chrono::duration<double, std::milli>(now - images[i].timestamp()).count();
+				healthyFrames++;
+			}
+		}
+
+		// recovery of the faulty camera
+		if (images[0].empty()) {
+			framesLost++;
+			if (!down) {
+				down = true;
+				downSince = t1;
+			}
+		}
+		else if (down) {
+			down = false;
+			recoveryMsec += msec(t1 - downSince).count();
+			recoveries++;
+		}
+	}
+
+	std::vector<CameraStats> stats = mvc.stats();
+	mvc.release();
+
+	std::cout << std::setw(12) << std::left << name
+		<< std::setw(14) << std::left << (recoveries ? recoveryMsec / recoveries : 0.0)
+		<< std::setw(8) << std::left << framesLost
+		<< std::setw(10) << std::left << stats[0].reconnects
+		<< std::setw(12) << std::left << (reads ? readMsec / reads : 0.0)
+		<< std::setw(12) << std::left << readMaxMsec
+		<< std::setw(12) << std::left << (healthyFrames ? healthyAgeMsec / healthyFrames : 0.0)
+		<< std::endl;
+}
+
+
+// unpaced cameras, the aggregate rate shows how well the capture threads scale.
+double benchScaling(const std::string& filename, int nbCams, double seconds, double baseFps) {
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+
+	BenchCapture mvc(filename, 0.f, FaultProfile());
+	mvc.open(camIds, -1, true);
+
+	typedef std::chrono::duration<double> sec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0;
+	while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+		mvc >> images;
+		reads++;
+	}
+	double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<CameraStats> stats = mvc.stats();
+	mvc.release();
+
+	unsigned long long grabbed = 0;
+	for (const auto& camera : stats) {
+		grabbed += camera.framesGrabbed;
+	}
+	double totalFps = grabbed / elapsed;
+	double perCamFps = totalFps / nbCams;
+	double efficiency = baseFps > 0.0 ? perCamFps / baseFps : 1.0;
+
+	std::cout << std::setw(10) << std::left << nbCams
+		<< std::setw(14) << std::left << totalFps
+		<< std::setw(14) << std::left << perCamFps
+		<< std::setw(12) << std::left << reads / elapsed
+		<< std::setw(12) << std::left << efficiency * 100.0
+		<< std::endl;
+
+	return perCamFps;
+}
+
+
+// the fields of a camera, packed next to each other as before the slots, or laid out as VideoCaptureType:
+// the status the consumer polls and the per-grab fields on their own cache lines.
+struct PackedCamera {
+	std::atomic<int> status;
+	std::atomic<long long> grabbed;
+	std::atomic<long long> lastGrab;
+};
+
+struct PaddedCamera {
+	alignas(CACHE_LINE_SIZE) std::atomic<int> status;
+	alignas(CACHE_LINE_SIZE) std::atomic<long long> grabbed;
+	std::atomic<long long> lastGrab;
+};
+
+
+// a writer thread per camera updating its fields, and the consumer polling all of them, in million updates/sec.
+template <typename Camera>
+double benchLayout(int nbCams, double seconds) {
+	Camera* cameras = static_cast<Camera*>(alignedMalloc(nbCams * sizeof(Camera)));
+	for (int i = 0; i < nbCams; i++) {
+		new (&cameras[i]) Camera();
+		cameras[i].status = 0;
+		cameras[i].grabbed = 0;
+		cameras[i].lastGrab = 0;
+	}
+
+	std::atomic<bool> running(true);
+	std::vector<std::thread> writers;
+	for (int i = 0; i < nbCams; i++) {
+		writers.emplace_back([&running, cameras, i]() {
+			Camera& camera = cameras[i];
+			long long grabbed = 0;
+			while (running.load(std::memory_order_relaxed)) {
+				grabbed++;
+				camera.grabbed.store(grabbed, std::memory_order_relaxed);
+				camera.lastGrab.store(grabbed, std::memory_order_release);
+			}
+		});
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long polls = 0;
+	while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+		for (int i = 0; i < nbCams; i++) {
+			polls += cameras[i].status.load(std::memory_order_acquire) == 0;
+		}
+	}
+	running = false;
+	for (auto& writer : writers) {
+		writer.join();
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	long long updates = 0;
+	for (int i = 0; i < nbCams; i++) {
+		updates += cameras[i].grabbed;
+		cameras[i].~Camera();
+	}
+	alignedFree(cameras);
+
+	return updates / elapsed / 1e6;
+}
+
+
+// a server on paced file cameras, and a client of the same process subscribed to some of them.
+void benchServe(const std::string& filename, int nbCams, double seconds, uint64_t cameras, double clientFps) {
+	const std::string path = "/tmp/MultiVideoCapture_bench.sock";
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+
+	BenchCapture mvc(filename, 30.f, FaultProfile());
+	FrameServer server(nbCams);
+	mvc.addStage(&server);
+	mvc.open(camIds, -1, true);
+	if (!server.start(path)) {
+		std::cout << "cannot start the frame server" << std::endl;
+		return;
+	}
+
+	std::atomic<bool> running(true);
+	std::atomic<long long> sets(0), frames(0);
+	std::atomic<double> latencyMsec(0.0);
+	std::thread client([&]() {
+		FrameClient frameClient;
+		if (!frameClient.connect(path, cameras, clientFps))
+			return;
+		std::vector<FrameType> received;
+		double latency = 0.0;
+		while (running && frameClient.read(received)) {
+			std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+			for (const auto& frame : received) {
+				if (!frame.empty()) {
+					latency += std::chrono::duration<double, std::milli>(now - frame.timestamp()).count();
+					frames++;
+				}
+			}
+			sets++;
+			latencyMsec = latency;
+		}
+	});
+
+	typedef std::chrono::duration<double> sec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0;
+	while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+		mvc >> images;
+		reads++;
+	}
+	double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+
+	// the client sees the hang up when the server stops
+	running = false;
+	FrameServerStats stats = server.stats();
+	server.stop();
+	client.join();
+	mvc.release();
+
+	std::cout << std::setw(12) << std::left << reads / elapsed
+		<< std::setw(14) << std::left << sets / elapsed
+		<< std::setw(14) << std::left << (frames ? latencyMsec / frames : 0.0)
+		<< std::setw(10) << std::left << stats.setsSent
+		<< std::setw(10) << std::left << stats.setsDropped
+		<< std::endl;
+}
+
+
+// the batch of a DNN built from every read, by the consumer after the read or by the capture threads.
+void benchTensor(const std::string& name, const std::string& filename, int nbCams, double seconds, bool staged) {
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+
+	TensorLayout layout;
+	TensorStage stage(nbCams, layout);
+	BenchCapture mvc(filename, 0.f, FaultProfile());
+	if (staged)
+		mvc.addStage(&stage);
+	mvc.open(camIds, -1, true);
+
+	// the consumer loop the stage replaces
+	int sizes[] = { nbCams, 3, layout.size.height, layout.size.width };
+	cv::Mat blob(4, sizes, CV_32F);
+	cv::Mat scaled, converted;
+	std::vector<cv::Mat> planes(3);
+
+	typedef std::chrono::duration<double> sec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0;
+	double batchMsec = 0.0;
+	while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+		mvc >> images;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		if (!staged) {
+			for (int i = 0; i < nbCams; i++) {
+				if (images[i].empty())
+					continue;
+				cv::resize(images[i].mat(), scaled, layout.size);
+				cv::cvtColor(scaled, scaled, cv::COLOR_BGR2RGB);
+				scaled.convertTo(converted, CV_32F, layout.scale);
+				float* slice = blob.ptr<float>(i);
+				for (int c = 0; c < 3; c++) {
+					planes[c] = cv::Mat(layout.size, CV_32F, slice + c * layout.size.area());
+				}
+				cv::split(converted, planes);
+			}
+		}
+		else {
+			blob = stage.tensor();
+		}
+		batchMsec += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		reads++;
+	}
+	double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+	mvc.release();
+
+	std::cout << std::setw(12) << std::left << name
+		<< std::setw(12) << std::left << reads / elapsed
+		<< std::setw(14) << std::left << (reads ? batchMsec / reads : 0.0)
+		<< std::endl;
+}
+
+
+// a consumer watching camera 0 and glancing at the others every 10th set, with full or lazy sets.
+void benchLazy(const std::string& name, const std::string& filename, int nbCams, double seconds, bool lazy) {
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+	LazyFrameSet set;
+
+	BenchCapture mvc(filename, 0.f, FaultProfile());
+	mvc.open(camIds, -1, true);
+
+	typedef std::chrono::duration<double> sec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long reads = 0, used = 0;
+	while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+		bool glance = reads % 10 == 0;
+		if (lazy) {
+			mvc.grab(set);
+			if (glance)
+				set.fetchAll();
+			used += !set[0].empty();
+		}
+		else {
+			mvc >> images;
+			used += !images[0].empty();
+		}
+		reads++;
+	}
+	double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+	set.release();
+
+	std::vector<CameraStats> stats = mvc.stats();
+	mvc.release();
+
+	unsigned long long undecoded = 0;
+	for (const auto& camera : stats) {
+		undecoded += camera.framesUndecoded;
+	}
+	std::cout << std::setw(12) << std::left << name
+		<< std::setw(12) << std::left << reads / elapsed
+		<< std::setw(12) << std::left << used
+		<< std::setw(14) << std::left << undecoded
+		<< std::endl;
+}
+
+
+// the demosaic of an RGGB mosaic made from the first frame of the file, per mode.
+void benchBayer(const std::string& filename, double seconds) {
+	cv::VideoCapture file(filename);
+	cv::Mat bgr;
+	if (!file.read(bgr) || bgr.type() != CV_8UC3)
+		return;
+
+	cv::Mat mosaic(bgr.size(), CV_8UC1);
+	for (int y = 0; y < bgr.rows; y++) {
+		for (int x = 0; x < bgr.cols; x++) {
+			int channel = (y & 1) == 0 ? ((x & 1) == 0 ? 2 : 1) : ((x & 1) == 0 ? 1 : 0);
+			mosaic.at<uchar>(y, x) = bgr.at<cv::Vec3b>(y, x)[channel];
+		}
+	}
+	FrameType frame;
+	frame.mat() = mosaic;
+
+	const char* names[] = { "full", "half", "gray" };
+	const DemosaicMode modes[] = { DemosaicMode::DEMOSAIC_FULL, DemosaicMode::DEMOSAIC_HALF, DemosaicMode::DEMOSAIC_GRAY };
+	typedef std::chrono::duration<double> sec;
+	for (int m = 0; m < 3; m++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		long long frames = 0;
+		size_t bytes = 0;
+		while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+			frame.setBayer(BayerPattern::BAYER_RGGB);	// a new frame, the cached colour is stale
+			cv::Mat color = frame.color(modes[m]);
+			bytes = color.total() * color.elemSize();
+			frames++;
+		}
+		double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+		std::cout << std::setw(12) << std::left << names[m]
+			<< std::setw(12) << std::left << elapsed * 1000.0 / frames
+			<< std::setw(12) << std::left << bytes / 1024
+			<< std::setw(12) << std::left << mosaic.total() / 1024
+			<< std::endl;
+	}
+}
+
+
+// the frames of the fast camera 0 and of the slow ones, read in lockstep or scheduled at their own rates.
+void benchDeadline(const std::string& name, const std::string& filename, int nbCams, double seconds, bool scheduled) {
+	std::vector<int> camIds(nbCams);
+	std::iota(camIds.begin(), camIds.end(), 0);
+	std::vector<FrameType> images(nbCams);
+
+	MixedCapture mvc(filename, 60.f, 10.f);
+	if (scheduled) {
+		std::vector<double> fps(nbCams, 10.0);
+		fps[0] = 60.0;
+		mvc.setSchedule(true, fps);
+	}
+	mvc.open(camIds, -1, true);
+
+	typedef std::chrono::duration<double> sec;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long fast = 0, slow = 0;
+	while (sec(std::chrono::steady_clock::now() - start).count() < seconds) {
+		mvc >> images;
+		fast += !images[0].empty();
+		for (int i = 1; i < nbCams; i++) {
+			slow += !images[i].empty();
+		}
+	}
+	double elapsed = sec(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<CameraStats> stats = mvc.stats();
+	mvc.release();
+
+	unsigned long long missed = 0;
+	double lateMsec = 0.0;
+	for (const auto& camera : stats) {
+		missed += camera.deadlinesMissed;
+		lateMsec = std::max(lateMsec, camera.lateMsec);
+	}
+	std::cout << std::setw(12) << std::left << name
+		<< std::setw(12) << std::left << fast / elapsed
+		<< std::setw(12) << std::left << slow / elapsed / (nbCams - 1)
+		<< std::setw(10) << std::left << missed
+		<< std::setw(10) << std::left << lateMsec
+		<< std::endl;
+}
+
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <video file> [cameras = 4] [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> scaling [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> static [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> serve [cameras = 4] [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> tensor [cameras = 4] [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> lazy [cameras = 4] [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> edf [cameras = 4] [seconds = 10]" << std::endl;
+		std::cout << "       " << argv[0] << " <video file> bayer [seconds = 10]" << std::endl;
+		return 1;
+	}
+	std::string filename = argv[1];
+
+	if (argc > 2 && std::string(argv[2]) == "static") {
+		double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+		std::cout << RIG_CAMERAS << " unpaced cameras, " << RigFormat::width << "x" << RigFormat::height << " BGR, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(16) << std::left << "engine"
+			<< std::setw(12) << std::left << "read[fps]"
+			<< std::setw(12) << std::left << "read[ms]"
+			<< std::setw(12) << std::left << "max[ms]"
+			<< std::setw(12) << std::left << "grab[fps]"
+			<< std::endl;
+		benchDynamic(filename, seconds);
+		benchStatic<SyncDelivery>("static sync", filename, seconds);
+		benchStatic<LatestDelivery>("static latest", filename, seconds);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "serve") {
+		int nbCams = argc > 3 ? std::max(2, std::atoi(argv[3])) : 4;
+		double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+		std::cout << nbCams << " cameras at 30 fps, served to a client of cameras 0 and 1, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(12) << std::left << "client[fps]"
+			<< std::setw(12) << std::left << "read[fps]"
+			<< std::setw(14) << std::left << "sets[fps]"
+			<< std::setw(14) << std::left << "latency[ms]"
+			<< std::setw(10) << std::left << "sent"
+			<< std::setw(10) << std::left << "dropped"
+			<< std::endl;
+		for (double fps : { 0.0, 10.0, 1.0 }) {
+			std::cout << std::setw(12) << std::left << (fps > 0.0 ? std::to_string((int)fps) : std::string("all"));
+			benchServe(filename, nbCams, seconds, 0x3, fps);
+		}
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "tensor") {
+		int nbCams = argc > 3 ? std::max(1, std::atoi(argv[3])) : 4;
+		double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+		std::cout << nbCams << " unpaced cameras into a " << nbCams << "x3x224x224 batch, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(12) << std::left << "batch"
+			<< std::setw(12) << std::left << "read[fps]"
+			<< std::setw(14) << std::left << "consumer[ms]"
+			<< std::endl;
+		benchTensor("consumer", filename, nbCams, seconds, false);
+		benchTensor("stage", filename, nbCams, seconds, true);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "lazy") {
+		int nbCams = argc > 3 ? std::max(2, std::atoi(argv[3])) : 4;
+		double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+		std::cout << nbCams << " unpaced cameras, camera 0 used on every set and the others on every 10th, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(12) << std::left << "sets"
+			<< std::setw(12) << std::left << "read[fps]"
+			<< std::setw(12) << std::left << "used"
+			<< std::setw(14) << std::left << "undecoded"
+			<< std::endl;
+		benchLazy("full", filename, nbCams, seconds, false);
+		benchLazy("lazy", filename, nbCams, seconds, true);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "bayer") {
+		double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+		std::cout << "demosaic of an RGGB mosaic of the first frame, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(12) << std::left << "mode"
+			<< std::setw(12) << std::left << "frame[ms]"
+			<< std::setw(12) << std::left << "out[KB]"
+			<< std::setw(12) << std::left << "raw[KB]"
+			<< std::endl;
+		benchBayer(filename, seconds);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "edf") {
+		int nbCams = argc > 3 ? std::max(2, std::atoi(argv[3])) : 4;
+		double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+		std::cout << "camera 0 at 60 fps and " << nbCams - 1 << " cameras at 10 fps, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(12) << std::left << "reads"
+			<< std::setw(12) << std::left << "fast[fps]"
+			<< std::setw(12) << std::left << "slow[fps]"
+			<< std::setw(10) << std::left << "missed"
+			<< std::setw(10) << std::left << "late[ms]"
+			<< std::endl;
+		benchDeadline("lockstep", filename, nbCams, seconds, false);
+		benchDeadline("edf", filename, nbCams, seconds, true);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[2]) == "scaling") {
+		double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+		std::cout << "1 to 16 unpaced cameras, " << seconds << " sec each" << std::endl;
+		std::cout << std::setw(10) << std::left << "cameras"
+			<< std::setw(14) << std::left << "total[fps]"
+			<< std::setw(14) << std::left << "camera[fps]"
+			<< std::setw(12) << std::left << "read[fps]"
+			<< std::setw(12) << std::left << "eff[%]"
+			<< std::endl;
+		double baseFps = benchScaling(filename, 1, seconds, 0.0);
+		for (int cams = 2; cams <= 16; cams *= 2) {
+			benchScaling(filename, cams, seconds, baseFps);
+		}
+
+		// the same cameras on the packed per-camera fields, without the decoding around them
+		std::cout << std::endl << "per-camera fields, packed vs padded" << std::endl;
+		std::cout << std::setw(10) << std::left << "cameras"
+			<< std::setw(16) << std::left << "packed[M/s]"
+			<< std::setw(16) << std::left << "padded[M/s]"
+			<< std::setw(10) << std::left << "gain"
+			<< std::endl;
+		for (int cams = 1; cams <= 16; cams *= 2) {
+			double packed = benchLayout<PackedCamera>(cams, std::min(seconds, 2.0));
+			double padded = benchLayout<PaddedCamera>(cams, std::min(seconds, 2.0));
+			std::cout << std::setw(10) << std::left << cams
+				<< std::setw(16) << std::left << packed
+				<< std::setw(16) << std::left << padded
+				<< std::setw(10) << std::left << (packed > 0.0 ? padded / packed : 0.0)
+				<< std::endl;
+		}
+		return 0;
+	}
+
+	int nbCams = argc > 2 ? std::max(2, std::atoi(argv[2])) : 4;
+	double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+
+	FaultProfile none;
+	FaultProfile slow;
+	slow.slowGrabMsec = 50.0;
+	slow.slowGrabRate = 0.2;
+	FaultProfile hang;
+	hang.hangAt = 60;
+	hang.hangMsec = 3000.0;
+	FaultProfile openFail;
+	openFail.openFailures = 2;
+	FaultProfile disconnect;
+	disconnect.disconnectAt = 90;
+	disconnect.reconnectMsec = 500.0;
+
+	std::cout << nbCams << " cameras, " << seconds << " sec per fault, fault injected into camera 0" << std::endl;
+	std::cout << std::setw(12) << std::left << "fault"
+		<< std::setw(14) << std::left << "recovery[ms]"
+		<< std::setw(8) << std::left << "lost"
+		<< std::setw(10) << std::left << "reconn"
+		<< std::setw(12) << std::left << "read[ms]"
+		<< std::setw(12) << std::left << "max[ms]"
+		<< std::setw(12) << std::left << "healthy[ms]"
+		<< std::endl;
+	benchFault("none", filename, nbCams, seconds, none);
+	benchFault("slow grab", filename, nbCams, seconds, slow);
+	benchFault("hang", filename, nbCams, seconds, hang);
+	benchFault("open fail", filename, nbCams, seconds, openFail);
+	benchFault("disconnect", filename, nbCams, seconds, disconnect);
+
+	return 0;
+}
@@ -4,6 +4,8 @@
 
 #include "opencv2/opencv.hpp"
 #include "MultiVideoCapture.hpp"
+#include "MosaicCompositor.hpp"
+#include "FrameHistory.hpp"
 
 
 int main() {
@@ -21,6 +23,19 @@ int main() {
 	mvc.open(camIds, CV_CAP_DSHOW, true);
 	mvc.set(camIds, resolution, fps);
 
+	// the capture threads tile the cameras into one image
+	MosaicLayout layout;
+	layout.tileSize = resolution;
+	MosaicCompositor mosaic(camIds.size(), layout);
+	mvc.addStage(&mosaic);
+
+	// the last seconds of every camera, 's' writes them to disk
+	HistorySettings history_settings;
+	history_settings.seconds = 10.0;
+	history_settings.compressed = true;
+	FrameHistory history(camIds.size(), history_settings);
+	mvc.addStage(&history);
+
 	std::chrono::milliseconds duration(long(1000.f / fps));
 	std::chrono::system_clock::time_point wait_until;
 	std::chrono::system_clock::time_point capture_times[2];
@@ -33,16 +48,15 @@ int main() {
 		mvc >> images;
 		capture_times[1] = std::chrono::system_clock::now();
 
+		// the mosaic is shared with the compositor, the cameras are flipped on a copy
+		cv::Mat view = mosaic.mosaic().clone();
 		for (int i = 0; i < camIds.size(); i++) {
-			cv::flip(images[i].mat(), images[i].mat(), 1);	// horizontal flip
+			cv::Mat tile = view(mosaic.tileRect(i));
+			cv::flip(tile, tile, 1);	// horizontal flip
 
-			const int id = camIds[i];
 			cam_times[i] = images[i].timestamp();
-			if (!images[i].empty())
-				cv::imshow("cam " + std::to_string(id), images[i].mat());
-			else
-				cv::imshow("cam " + std::to_string(id), cv::Mat::zeros(resolution, CV_8UC3));
 		}
+		cv::imshow("cameras", view);
 
 		std::chrono::duration<double> capture_sec = capture_times[1] - capture_times[0];
 		std::chrono::duration<double> diff_sec = cam_times[0] - cam_times[1];
@@ -51,10 +65,16 @@ int main() {
 		std::cout << "\ttime difference: " << std::setw(9) << std::left << diff_sec.count() << " sec" << std::endl;
 
 		c = cv::waitKey(1);
+		if (c == 's') {
+			std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+			history.flush(now - std::chrono::seconds(10), now, "incident");
+		}
 
 		std::this_thread::sleep_until(wait_until);
 	}
 
+	mvc.removeStage(&history);
+	mvc.removeStage(&mosaic);
 	mvc.release();
 
 	return 1;
@@ -0,0 +1,80 @@
+#include "AlignedAlloc.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#  include <malloc.h>
+#else
+#  include <unistd.h>
+#endif
+#ifdef __linux__
+#  include <sys/syscall.h>
+#  include "boost/filesystem.hpp"
+#endif
+
+
+void* alignedMalloc(size_t size, int numaNode) {
+#ifdef _WIN32
+	return _aligned_malloc(size, CACHE_LINE_SIZE);
+#else
+	size_t alignment = CACHE_LINE_SIZE;
+	bool bind = numaNode >= 0 && numaNodeCount() > 1;
+	if (bind) {
+		// a NUMA policy applies to whole pages
+		alignment = (size_t)sysconf(_SC_PAGESIZE);
+		size = (size + alignment - 1) / alignment * alignment;
+	}
+
+	void* ptr = NULL;
+	if (posix_memalign(&ptr, alignment, size) != 0)
+		return NULL;
+
+#ifdef __linux__
+	if (bind) {
+		const unsigned long MPOL_PREFERRED_ = 1;	// numaif.h is not required
+		unsigned long nodemask = 1UL << numaNode;
+		syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_, &nodemask, sizeof(nodemask) * 8, 0);
+	}
+#endif
+	std::memset(ptr, 0, size);	// first touch
+
+	return ptr;
+#endif
+}
+
+
+void alignedFree(void* ptr) {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+
+int currentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned int cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return (int)node;
+#endif
+	return -1;
+}
+
+
+int numaNodeCount() {
+#ifdef __linux__
+	static const int count = []() {
+		int nodes = 0;
+		boost::system::error_code ec;
+		while (boost::filesystem::exists("/sys/devices/system/node/node" + std::to_string(nodes), ec)) {
+			nodes++;
+		}
+		return nodes > 0 ? nodes : 1;
+	}();
+	return count;
+#else
+	return 1;
+#endif
+}
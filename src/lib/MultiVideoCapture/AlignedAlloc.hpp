@@ -0,0 +1,29 @@
+#ifndef ALIGNED_ALLOC_H_
+#define ALIGNED_ALLOC_H_
+
+
+#ifndef __cplusplus
+#  error AlignedAlloc.hpp header must be compiled as C++
+#endif
+
+#include <cstddef>
+
+
+#ifndef CACHE_LINE_SIZE
+#  define CACHE_LINE_SIZE 64
+#endif
+
+
+/**
+ * @brief   Allocates cache-line aligned memory, placed on the given NUMA node when there are several.
+ * @note    Memory placed on a node is page aligned and already touched by the calling thread.
+ *          Always release it with alignedFree().
+ */
+void* alignedMalloc(size_t size, int numaNode = -1);
+void alignedFree(void* ptr);
+
+int currentNumaNode();	// -1 when unknown
+int numaNodeCount();
+
+
+#endif // !ALIGNED_ALLOC_H_
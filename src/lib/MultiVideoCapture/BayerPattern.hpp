@@ -0,0 +1,54 @@
+#ifndef BAYER_PATTERN_H_
+#define BAYER_PATTERN_H_
+
+
+#ifndef __cplusplus
+#  error BayerPattern.hpp header must be compiled as C++
+#endif
+
+
+/**
+ * @brief   Colour filter layout of a raw frame, named after its top-left 2x2 block row by row.
+ * @note    BAYER_RGGB is the cv::COLOR_BayerBG2BGR input of OpenCV, which names the pattern by the
+ *          second row instead.
+ */
+enum class BayerPattern {
+	BAYER_NONE = 0,	// the frame is not a mosaic
+	BAYER_RGGB,
+	BAYER_BGGR,
+	BAYER_GRBG,
+	BAYER_GBRG,
+};
+
+
+enum class DemosaicMode {
+	DEMOSAIC_FULL = 0,	// BGR at the sensor resolution
+	DEMOSAIC_HALF,	// BGR at half the resolution, one pixel per 2x2 block
+	DEMOSAIC_GRAY,	// luminance at the sensor resolution
+};
+
+
+// lower case, for the names of the raw files. "" for BAYER_NONE.
+inline const char* bayerName(BayerPattern pattern) {
+	static const char* names[] = { "", "rggb", "bggr", "grbg", "gbrg" };
+	return names[(int)pattern];
+}
+
+
+// the pattern of a crop starting at (x, y) of a frame with the given pattern.
+inline BayerPattern shiftBayer(BayerPattern pattern, int x, int y) {
+	if (pattern == BayerPattern::BAYER_NONE)
+		return pattern;
+
+	static const BayerPattern swapX[] = { BayerPattern::BAYER_NONE, BayerPattern::BAYER_GRBG, BayerPattern::BAYER_GBRG, BayerPattern::BAYER_RGGB, BayerPattern::BAYER_BGGR };
+	static const BayerPattern swapY[] = { BayerPattern::BAYER_NONE, BayerPattern::BAYER_GBRG, BayerPattern::BAYER_GRBG, BayerPattern::BAYER_BGGR, BayerPattern::BAYER_RGGB };
+	if (x & 1)
+		pattern = swapX[(int)pattern];
+	if (y & 1)
+		pattern = swapY[(int)pattern];
+
+	return pattern;
+}
+
+
+#endif // !BAYER_PATTERN_H_
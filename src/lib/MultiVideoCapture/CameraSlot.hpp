@@ -0,0 +1,89 @@
+#ifndef CAMERA_SLOT_H_
+#define CAMERA_SLOT_H_
+
+
+#ifndef __cplusplus
+#  error CameraSlot.hpp header must be compiled as C++
+#endif
+
+#include <new>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "AlignedAlloc.hpp"
+#include "VideoCaptureType.hpp"
+
+
+/**
+ * @brief   Per-camera state of MultiVideoCapture, one padded cache line block per camera.
+ */
+struct alignas(CACHE_LINE_SIZE) CameraSlot {
+	VideoCaptureType* capture = NULL;
+	cv::Size resolution;
+	float fps = 0.f;
+	cv::Rect roi;	// empty for the full frame
+	int decimation = 1;
+	double priority = 1.0;	// weight of the frame-rate governor
+};
+
+
+/**
+ * @brief   Fixed-size array of camera slots in a single aligned allocation.
+ * @note    The slots don't own their captures.
+ */
+class CameraSlots {
+public:
+	CameraSlots() : mSlots(NULL), mSize(0) {}
+	virtual ~CameraSlots() { clear(); }
+
+	void resize(size_t size) {
+		clear();
+		if (size == 0)
+			return;
+
+		mSlots = static_cast<CameraSlot*>(alignedMalloc(size * sizeof(CameraSlot), currentNumaNode()));
+		if (mSlots == NULL)
+			throw std::bad_alloc();
+		for (size_t i = 0; i < size; i++) {
+			new (&mSlots[i]) CameraSlot();
+		}
+		mSize = size;
+	}
+
+	void clear() {
+		for (size_t i = 0; i < mSize; i++) {
+			mSlots[i].~CameraSlot();
+		}
+		alignedFree(mSlots);
+		mSlots = NULL;
+		mSize = 0;
+	}
+
+	size_t size() const { return mSize; }
+	bool empty() const { return mSize == 0; }
+
+	CameraSlot& operator[](size_t i) { return mSlots[i]; }
+	const CameraSlot& operator[](size_t i) const { return mSlots[i]; }
+	CameraSlot* begin() { return mSlots; }
+	CameraSlot* end() { return mSlots + mSize; }
+	const CameraSlot* begin() const { return mSlots; }
+	const CameraSlot* end() const { return mSlots + mSize; }
+
+	std::vector<VideoCaptureType*> captures() const {
+		std::vector<VideoCaptureType*> res(mSize);
+		for (size_t i = 0; i < mSize; i++) {
+			res[i] = mSlots[i].capture;
+		}
+		return res;
+	}
+
+private:
+	CameraSlots(const CameraSlots&);
+	CameraSlots& operator=(const CameraSlots&);
+
+	CameraSlot* mSlots;
+	size_t mSize;
+};
+
+
+#endif // !CAMERA_SLOT_H_
@@ -0,0 +1,96 @@
+#ifndef CAPTURE_AWAIT_H_
+#define CAPTURE_AWAIT_H_
+
+
+#ifndef __cplusplus
+#  error CaptureAwait.hpp header must be compiled as C++
+#endif
+
+// the library itself stays C++11, this header is only for the C++20 callers.
+#ifdef __cpp_impl_coroutine
+
+#include <coroutine>
+#include <vector>
+
+#include "MultiVideoCapture.hpp"
+
+
+/**
+ * @brief   co_await on the reads of a MultiVideoCapture, on top of readAsync().
+ * @note    The coroutine resumes on the executor given to setExecutor(), or else right on
+ *          the capture thread finishing last. The result is the status of the read, false as
+ *          well when a read of the same cameras is still running.
+ *          The frames must outlive the suspension, as with read().
+ *
+ *              std::vector<FrameType> frames;
+ *              while (co_await nextFrameSet(mvc, frames)) { ... }
+ */
+class FrameSetAwaiter {
+public:
+	FrameSetAwaiter(MultiVideoCapture& capture, std::vector<FrameType>& frames)
+		: mCapture(capture), mFrames(frames), mStatus(false) {}
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+
+	bool await_suspend(std::coroutine_handle<> handle) {
+		// the callback may resume the coroutine before readAsync() returns, nothing is touched after it
+		return mCapture.readAsync(mFrames, [this, handle](bool status) {
+			mStatus = status;
+			handle.resume();
+		});
+	}
+
+	bool await_resume() const noexcept {
+		return mStatus;
+	}
+
+private:
+	MultiVideoCapture& mCapture;
+	std::vector<FrameType>& mFrames;
+	bool mStatus;
+};
+
+
+class FrameAwaiter {
+public:
+	FrameAwaiter(MultiVideoCapture& capture, size_t camera, FrameType& frame)
+		: mCapture(capture), mCamera(camera), mFrame(frame), mStatus(false) {}
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+
+	bool await_suspend(std::coroutine_handle<> handle) {
+		return mCapture.readAsync(mCamera, mFrame, [this, handle](bool status) {
+			mStatus = status;
+			handle.resume();
+		});
+	}
+
+	bool await_resume() const noexcept {
+		return mStatus;
+	}
+
+private:
+	MultiVideoCapture& mCapture;
+	size_t mCamera;
+	FrameType& mFrame;
+	bool mStatus;
+};
+
+
+inline FrameSetAwaiter nextFrameSet(MultiVideoCapture& capture, std::vector<FrameType>& frames) {
+	return FrameSetAwaiter(capture, frames);
+}
+
+
+inline FrameAwaiter nextFrame(MultiVideoCapture& capture, size_t camera, FrameType& frame) {
+	return FrameAwaiter(capture, camera, frame);
+}
+
+
+#endif	// __cpp_impl_coroutine
+
+#endif // !CAPTURE_AWAIT_H_
@@ -0,0 +1,45 @@
+#ifndef CAPTURE_STATS_H_
+#define CAPTURE_STATS_H_
+
+
+#ifndef __cplusplus
+#  error CaptureStats.hpp header must be compiled as C++
+#endif
+
+#include <cstddef>
+
+
+/**
+ * @brief   Counters of a single camera since it was created.
+ */
+struct CameraStats {
+	unsigned long long framesGrabbed = 0;
+	unsigned long long framesFailed = 0;	// grabs that returned no frame
+	unsigned long long reconnects = 0;	// successful opens after the first one
+	double grabMsec = 0.0;	// duration of the last grab
+	unsigned long long framesSkipped = 0;	// reads skipped by the frame-rate governor
+	double rateScale = 1.0;	// fraction of the nominal rate allowed by the governor
+	unsigned long long framesDuplicate = 0;	// frames the camera delivered again
+	double staleMsec = 0.0;	// since the last new frame
+	unsigned long long framesUndecoded = 0;	// grabs dropped by the next grab without a retrieve
+	unsigned long long deadlinesMet = 0;	// scheduled reads done within their period
+	unsigned long long deadlinesMissed = 0;	// scheduled reads done after their deadline
+	double lateMsec = 0.0;	// mean lateness of the missed deadlines
+};
+
+
+/**
+ * @brief   Occupancy of the frame buffer arena shared by the cameras.
+ */
+struct ArenaStats {
+	size_t reservedBytes = 0;
+	bool hugePages = false;	// the region is backed by huge pages
+	size_t slots = 0;
+	size_t slotsInUse = 0;
+	size_t peakSlotsInUse = 0;
+	size_t bytesInUse = 0;	// bytes of the frames in the slots in use
+	unsigned long long fallbacks = 0;	// buffers served by the default allocator, no slot was free
+};
+
+
+#endif // !CAPTURE_STATS_H_
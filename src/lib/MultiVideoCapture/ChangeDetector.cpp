@@ -0,0 +1,137 @@
+#include "ChangeDetector.hpp"
+
+#include <algorithm>
+
+#include "Trace.hpp"
+
+
+ChangeDetector::ChangeDetector(size_t cameras, const ChangeSettings& settings) {
+	mDetectors.resize(cameras);
+	setSettings(settings);
+}
+
+
+ChangeDetector::~ChangeDetector() {
+}
+
+
+bool ChangeDetector::process(size_t camera, FrameType& frame) {
+	if (camera >= mDetectors.size() || frame.empty())
+		return true;
+
+	const cv::Mat& src = frame.mat();
+	if (src.depth() != CV_8U || (src.channels() != 1 && src.channels() != 3 && src.channels() != 4))
+		return true;	// not detected, always changed
+
+	MVC_TRACE_SCOPE_ARG("change.detect", (int)camera);
+	Detector& detector = mDetectors[camera];
+	bool changed = detect(detector, src);
+
+	// the keep-alive tells the consumers the camera is still there
+	bool keepAlive = false;
+	if (!changed && mSettings.keepAliveSeconds > 0.0 &&
+		std::chrono::duration<double>(frame.timestamp() - detector.lastDelivered).count() >= mSettings.keepAliveSeconds) {
+		keepAlive = true;
+	}
+
+	bool deliver = changed || keepAlive || mSettings.gate == ChangeGate::CHANGE_FLAG;
+	if (changed || keepAlive)
+		detector.lastDelivered = frame.timestamp();
+	frame.setChanged(changed);
+
+	{
+		std::lock_guard<std::mutex> lock(mMtxStats);
+		ChangeStats& stats = detector.stats;
+		if (changed)
+			stats.framesChanged++;
+		else
+			stats.framesUnchanged++;
+		if (!deliver)
+			stats.framesSuppressed++;
+		if (keepAlive)
+			stats.keepAlives++;
+		stats.dirtyRatio = (double)cv::countNonZero(detector.dirty) / detector.dirty.total();
+	}
+
+	return deliver;
+}
+
+
+cv::Mat ChangeDetector::dirtyTiles(size_t camera) const {
+	return camera < mDetectors.size() ? mDetectors[camera].dirty : cv::Mat();
+}
+
+
+cv::Rect ChangeDetector::tileRect(size_t camera, int col, int row) const {
+	if (camera >= mDetectors.size())
+		return cv::Rect();
+
+	cv::Size frameSize = mDetectors[camera].frameSize;
+	int x0 = col * frameSize.width / mSettings.grid.width;
+	int y0 = row * frameSize.height / mSettings.grid.height;
+	int x1 = (col + 1) * frameSize.width / mSettings.grid.width;
+	int y1 = (row + 1) * frameSize.height / mSettings.grid.height;
+
+	return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+
+std::vector<ChangeStats> ChangeDetector::stats() const {
+	std::lock_guard<std::mutex> lock(mMtxStats);
+	std::vector<ChangeStats> res;
+	for (const auto& detector : mDetectors) {
+		res.push_back(detector.stats);
+	}
+
+	return res;
+}
+
+
+void ChangeDetector::setSettings(const ChangeSettings& settings) {
+	mSettings = settings;
+	mSettings.grid.width = std::max(1, mSettings.grid.width);
+	mSettings.grid.height = std::max(1, mSettings.grid.height);
+	mSettings.samples = std::max(1, mSettings.samples);
+	mSettings.learningRate = std::min(1.0, std::max(0.0, mSettings.learningRate));
+
+	for (auto& detector : mDetectors) {
+		detector.frameSize = cv::Size();
+		detector.background.release();
+		detector.dirty = cv::Mat(mSettings.grid, CV_8U, cv::Scalar(255));
+	}
+}
+
+
+ChangeSettings ChangeDetector::settings() const {
+	return mSettings;
+}
+
+
+bool ChangeDetector::detect(Detector& detector, const cv::Mat& src) {
+	// nearest sampling only reads the sampled pixels, the color conversion runs on the small image
+	cv::Size smallSize(mSettings.grid.width * mSettings.samples, mSettings.grid.height * mSettings.samples);
+	if (src.channels() == 1) {
+		cv::resize(src, detector.small, smallSize, 0, 0, cv::INTER_NEAREST);
+	}
+	else {
+		cv::resize(src, detector.sampled, smallSize, 0, 0, cv::INTER_NEAREST);
+		cv::cvtColor(detector.sampled, detector.small, src.channels() == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+	}
+	detector.small.convertTo(detector.smallF, CV_32F);
+
+	if (detector.background.empty() || detector.frameSize != src.size()) {
+		// a new camera or a new ROI: everything changed
+		detector.frameSize = src.size();
+		detector.smallF.copyTo(detector.background);
+		detector.dirty.setTo(cv::Scalar(255));
+		return true;
+	}
+
+	// sum of absolute differences per tile, as the mean of its samples
+	cv::absdiff(detector.smallF, detector.background, detector.diff);
+	cv::resize(detector.diff, detector.tileDiff, mSettings.grid, 0, 0, cv::INTER_AREA);
+	cv::compare(detector.tileDiff, cv::Scalar(mSettings.tileThreshold), detector.dirty, cv::CMP_GT);
+	cv::accumulateWeighted(detector.smallF, detector.background, mSettings.learningRate);
+
+	return cv::countNonZero(detector.dirty) >= mSettings.minDirtyTiles;
+}
@@ -0,0 +1,97 @@
+#ifndef CHANGE_DETECTOR_H_
+#define CHANGE_DETECTOR_H_
+
+
+#ifndef __cplusplus
+#  error ChangeDetector.hpp header must be compiled as C++
+#endif
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   What the ChangeDetector does with a frame where nothing changed.
+ */
+enum class ChangeGate {
+	CHANGE_FLAG = 0,	// delivered, with isChanged() false
+	CHANGE_SUPPRESS,	// not delivered, the frame is left empty and the next stages skip it
+};
+
+
+/**
+ * @brief   Sensitivity of the ChangeDetector.
+ * @note    The frame is sampled down to samples x samples luma pixels per tile, a tile is dirty when
+ *          the mean absolute difference of its samples to the background exceeds tileThreshold.
+ */
+struct ChangeSettings {
+	cv::Size grid = { 16, 12 };	// tiles
+	int samples = 8;	// per tile side
+	double tileThreshold = 12.0;	// [0, 255]
+	int minDirtyTiles = 1;	// for the frame to be changed
+	double learningRate = 0.05;	// of the running background, per frame
+	double keepAliveSeconds = 1.0;	// an unchanged frame is still delivered this often, 0 never
+	ChangeGate gate = ChangeGate::CHANGE_FLAG;
+};
+
+
+/**
+ * @brief   Counters of the change detection of a camera.
+ */
+struct ChangeStats {
+	unsigned long long framesChanged = 0;
+	unsigned long long framesUnchanged = 0;
+	unsigned long long framesSuppressed = 0;
+	unsigned long long keepAlives = 0;	// unchanged frames delivered for the keep-alive
+	double dirtyRatio = 0.0;	// of the tiles, in the last frame
+};
+
+
+/**
+ * @brief   Stage flagging or dropping the frames where nothing moved, on the capture thread.
+ * @note    Add it before the other stages: a suppressed frame skips them, and the stages which keep
+ *          their last output (mosaic, tensor) skip the unchanged frames. dirtyTiles() tells which
+ *          regions changed, for the stages and the consumer.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS ChangeDetector : public FrameStage {
+public:
+	ChangeDetector(size_t cameras, const ChangeSettings& settings = ChangeSettings());
+	virtual ~ChangeDetector();
+
+	virtual bool process(size_t camera, FrameType& frame);
+
+	virtual cv::Mat dirtyTiles(size_t camera) const;	// grid sized CV_8U, 255 for a dirty tile. valid until the next read()
+	virtual cv::Rect tileRect(size_t camera, int col, int row) const;	// in the frame
+	virtual std::vector<ChangeStats> stats() const;
+
+	virtual void setSettings(const ChangeSettings& settings);	// only between two reads, restarts the backgrounds
+	virtual ChangeSettings settings() const;
+
+protected:
+	struct Detector {
+		cv::Size frameSize;
+		cv::Mat sampled;	// in the colors of the frame
+		cv::Mat small;	// sampled luma
+		cv::Mat smallF;
+		cv::Mat background;	// CV_32F, running average of small
+		cv::Mat diff;
+		cv::Mat tileDiff;	// mean per tile
+		cv::Mat dirty;
+		std::chrono::system_clock::time_point lastDelivered;
+		ChangeStats stats;
+	};
+
+	virtual bool detect(Detector& detector, const cv::Mat& src);
+
+protected:
+	ChangeSettings mSettings;
+	std::vector<Detector> mDetectors;
+	mutable std::mutex mMtxStats;
+};
+
+
+#endif // !CHANGE_DETECTOR_H_
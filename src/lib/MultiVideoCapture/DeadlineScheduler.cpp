@@ -0,0 +1,234 @@
+#include "DeadlineScheduler.hpp"
+
+#include <algorithm>
+
+#include "Trace.hpp"
+
+
+DeadlineScheduler::DeadlineScheduler(size_t workers) {
+	mWorkers = std::max<size_t>(1, workers);
+	mRunning = false;
+	mHooksRunning = 0;
+	mExclusive = false;
+}
+
+
+DeadlineScheduler::~DeadlineScheduler() {
+	stop();
+}
+
+
+void DeadlineScheduler::start(const std::vector<VideoCaptureType*>& sources, const std::vector<double>& fps, FrameHook hook) {
+	stop();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	mTasks.resize(sources.size());
+	for (size_t i = 0; i < sources.size(); i++) {
+		Task& task = mTasks[i];
+		double rate = i < fps.size() && fps[i] > 0.0 ? fps[i] : 30.0;
+		task.source = sources[i];
+		task.period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+		task.release = now;
+		task.deadline = now + task.period;
+		task.running = false;
+		task.fresh = false;
+		task.deadlinesMet = 0;
+		task.deadlinesMissed = 0;
+		task.lateMsec = 0.0;
+	}
+	mHook = hook;
+
+	mRunning = true;
+	size_t workers = std::min(mWorkers, std::max<size_t>(1, sources.size()));
+	for (size_t i = 0; i < workers; i++) {
+		mThreads.emplace_back(&DeadlineScheduler::work, this);
+	}
+}
+
+
+void DeadlineScheduler::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mMtxTasks);
+		mRunning = false;
+	}
+	mCvTasks.notify_all();
+	mCvFrames.notify_all();
+	for (auto& thread : mThreads) {
+		if (thread.joinable())
+			thread.join();
+	}
+	mThreads.clear();
+}
+
+
+bool DeadlineScheduler::isRunning() const {
+	return mRunning;
+}
+
+
+bool DeadlineScheduler::readLatest(std::vector<FrameType>& frames, double timeoutMsec, std::function<void()> endCycle) {
+	{
+		std::unique_lock<std::mutex> lock(mMtxTasks);
+		auto ready = [this]() {
+			return !mRunning || std::any_of(mTasks.begin(), mTasks.end(), [](const Task& task) { return task.fresh; });
+		};
+		if (timeoutMsec < 0.0)
+			mCvFrames.wait(lock, ready);
+		else
+			mCvFrames.wait_for(lock, std::chrono::duration<double, std::milli>(timeoutMsec), ready);
+	}
+
+	// the frames delivered are the ones the stages processed in the cycle they end
+	bool status = false;
+	exclusive([this, &frames, &status, &endCycle]() {
+		{
+			std::lock_guard<std::mutex> lock(mMtxTasks);
+			if (frames.size() != mTasks.size())
+				frames.resize(mTasks.size());
+
+			// the frame given back is the next buffer of the worker, nothing is copied
+			for (size_t i = 0; i < mTasks.size(); i++) {
+				if (mTasks[i].fresh) {
+					std::swap(frames[i], mTasks[i].latest);
+					mTasks[i].fresh = false;
+					status = true;
+				}
+				else {
+					frames[i].release();
+				}
+			}
+		}
+		if (endCycle)
+			endCycle();
+	});
+
+	return status;
+}
+
+
+void DeadlineScheduler::exclusive(std::function<void()> job) {
+	std::unique_lock<std::mutex> lock(mMtxHooks);
+	mCvHooks.wait(lock, [this]() { return !mExclusive; });
+	mExclusive = true;
+	mCvHooks.wait(lock, [this]() { return mHooksRunning == 0; });
+	lock.unlock();
+
+	// the hooks wait meanwhile, they are released even when the job throws
+	struct Release {
+		DeadlineScheduler* self;
+		~Release() {
+			std::lock_guard<std::mutex> lock(self->mMtxHooks);
+			self->mExclusive = false;
+			self->mCvHooks.notify_all();
+		}
+	} release = { this };
+	job();
+}
+
+
+void DeadlineScheduler::fillStats(size_t index, CameraStats& stats) const {
+	std::lock_guard<std::mutex> lock(mMtxTasks);
+	if (index >= mTasks.size())
+		return;
+
+	const Task& task = mTasks[index];
+	stats.deadlinesMet = task.deadlinesMet;
+	stats.deadlinesMissed = task.deadlinesMissed;
+	stats.lateMsec = task.deadlinesMissed ? task.lateMsec / task.deadlinesMissed : 0.0;
+}
+
+
+void DeadlineScheduler::work() {
+	MVC_TRACE_THREAD_NAME("edf worker");
+	std::unique_lock<std::mutex> lock(mMtxTasks);
+	while (mRunning) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point wakeAt = now + std::chrono::seconds(1);
+		int index = pick(now, wakeAt);
+		if (index < 0) {
+			mCvTasks.wait_until(lock, wakeAt);
+			continue;
+		}
+
+		Task& task = mTasks[index];
+		task.running = true;
+		std::chrono::steady_clock::time_point deadline = task.deadline;
+		lock.unlock();
+
+		bool status = false;
+		bool opened = task.source->status() == CamStatus::CAM_STATUS_OPENED || task.source->isReplaying();
+		if (opened) {
+			MVC_TRACE_SCOPE_ARG("edf.read", index);
+			status = task.source->read(task.back);
+		}
+
+		// the frame is published before the hook is left, so it is delivered in the cycle of its stages
+		bool hooked = status;
+		if (hooked) {
+			enterHook();
+			if (mHook)
+				mHook((size_t)index, task.back);
+			status = !task.back.empty();
+		}
+		std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+		lock.lock();
+		if (opened) {
+			if (finish > deadline) {
+				task.deadlinesMissed++;
+				task.lateMsec += std::chrono::duration<double, std::milli>(finish - deadline).count();
+			}
+			else {
+				task.deadlinesMet++;
+			}
+		}
+		if (status) {
+			std::swap(task.back, task.latest);
+			task.fresh = true;
+			mCvFrames.notify_all();
+		}
+		if (hooked)
+			leaveHook();
+
+		// the next period, or a fresh start when more than a period behind
+		task.release += task.period;
+		if (task.release + task.period < finish)
+			task.release = finish;
+		task.deadline = task.release + task.period;
+		task.running = false;
+		mCvTasks.notify_all();
+	}
+}
+
+
+void DeadlineScheduler::enterHook() {
+	std::unique_lock<std::mutex> lock(mMtxHooks);
+	mCvHooks.wait(lock, [this]() { return !mExclusive; });
+	mHooksRunning++;
+}
+
+
+void DeadlineScheduler::leaveHook() {
+	std::lock_guard<std::mutex> lock(mMtxHooks);
+	if (--mHooksRunning == 0)
+		mCvHooks.notify_all();
+}
+
+
+// called with mMtxTasks held
+int DeadlineScheduler::pick(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& wakeAt) const {
+	int index = -1;
+	for (size_t i = 0; i < mTasks.size(); i++) {
+		const Task& task = mTasks[i];
+		if (task.running)
+			continue;
+		if (task.release > now) {
+			wakeAt = std::min(wakeAt, task.release);
+		}
+		else if (index < 0 || task.deadline < mTasks[index].deadline) {
+			index = (int)i;
+		}
+	}
+
+	return index;
+}
@@ -0,0 +1,86 @@
+#ifndef DEADLINE_SCHEDULER_H_
+#define DEADLINE_SCHEDULER_H_
+
+
+#ifndef __cplusplus
+#  error DeadlineScheduler.hpp header must be compiled as C++
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameType.hpp"
+#include "CaptureStats.hpp"
+#include "VideoCaptureType.hpp"
+
+
+/**
+ * @brief   Reads every camera at its own rate, earliest deadline first.
+ * @note    A camera is released once per period and its read is due by the next release.
+ *          The workers always take the released camera with the earliest deadline, so with fewer
+ *          workers than cameras the fast cameras go first. A camera more than a period behind
+ *          drops the missed periods instead of catching up.
+ *          The hooks of the workers and exclusive() never overlap, so the stages can end their
+ *          cycle, or be changed, between two process() calls only.
+ */
+class DeadlineScheduler {
+public:
+	typedef std::function<void(size_t, FrameType&)> FrameHook;	// runs on the worker after each read
+
+	DeadlineScheduler(size_t workers);
+	virtual ~DeadlineScheduler();
+
+	virtual void start(const std::vector<VideoCaptureType*>& sources, const std::vector<double>& fps, FrameHook hook);
+	virtual void stop();
+	virtual bool isRunning() const;
+
+	// endCycle runs after the swap, while no hook runs
+	virtual bool readLatest(std::vector<FrameType>& frames, double timeoutMsec, std::function<void()> endCycle = std::function<void()>());
+	virtual void exclusive(std::function<void()> job);	// waits for the running hooks, and holds the next ones
+	virtual void fillStats(size_t index, CameraStats& stats) const;
+
+protected:
+	struct Task {
+		VideoCaptureType* source;
+		std::chrono::steady_clock::duration period;
+		std::chrono::steady_clock::time_point release;
+		std::chrono::steady_clock::time_point deadline;
+		bool running;
+		FrameType back;	// written by the worker
+		FrameType latest;
+		bool fresh;	// latest is not read yet
+
+		unsigned long long deadlinesMet;
+		unsigned long long deadlinesMissed;
+		double lateMsec;	// sum over the misses
+	};
+
+	virtual void work();
+	virtual int pick(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& wakeAt) const;
+	virtual void enterHook();
+	virtual void leaveHook();
+
+protected:
+	size_t mWorkers;
+	std::vector<Task> mTasks;
+	std::vector<std::thread> mThreads;
+	FrameHook mHook;
+	std::atomic<bool> mRunning;
+
+	mutable std::mutex mMtxTasks;
+	std::condition_variable mCvTasks;	// a task was released or finished
+	std::condition_variable mCvFrames;	// a frame is ready
+
+	std::mutex mMtxHooks;
+	std::condition_variable mCvHooks;
+	int mHooksRunning;
+	bool mExclusive;	// an exclusive job waits or runs, no hook starts
+};
+
+
+#endif // !DEADLINE_SCHEDULER_H_
@@ -0,0 +1,22 @@
+#ifndef DEDUPLICATION_H_
+#define DEDUPLICATION_H_
+
+
+#ifndef __cplusplus
+#  error Deduplication.hpp header must be compiled as C++
+#endif
+
+
+/**
+ * @brief   Handling of the frames a camera delivers again, when it is grabbed faster than its sensor runs.
+ * @note    A repeat is detected by the device timestamp of the buffer where the backend reports it,
+ *          otherwise by a sampled hash of the pixels. Video files are never deduplicated.
+ */
+enum class DedupMode {
+	DEDUP_OFF = 0,	// every grabbed frame is delivered as new
+	DEDUP_FLAG,	// repeated frames are delivered, flagged as duplicates
+	DEDUP_SUPPRESS,	// repeated frames are not delivered, the frame is left empty
+};
+
+
+#endif // !DEDUPLICATION_H_
@@ -0,0 +1,83 @@
+#include "Demosaic.hpp"
+
+#include "Trace.hpp"
+
+
+namespace {
+	// one BGR pixel per 2x2 block, R and B at fixed offsets of the block, G on the other two.
+	// the offsets are constants, so the compiler vectorizes the strided loads.
+	template <typename T, typename Sum, int R, int B>
+	void binHalf(const cv::Mat& raw, cv::Mat& dst) {
+		const int G1 = (R == 0 || R == 3) ? 1 : 0;	// R and B on one diagonal, G on the other
+		const int G2 = 3 - G1;
+		for (int y = 0; y < dst.rows; y++) {
+			const T* r0 = raw.ptr<T>(2 * y);
+			const T* r1 = raw.ptr<T>(2 * y + 1);
+			T* d = dst.ptr<T>(y);
+			for (int x = 0; x < dst.cols; x++) {
+				const T q[4] = { r0[2 * x], r0[2 * x + 1], r1[2 * x], r1[2 * x + 1] };
+				d[3 * x] = q[B];
+				d[3 * x + 1] = (T)(((Sum)q[G1] + q[G2] + 1) >> 1);
+				d[3 * x + 2] = q[R];
+			}
+		}
+	}
+
+
+	template <typename T, typename Sum>
+	void binHalf(const cv::Mat& raw, BayerPattern pattern, cv::Mat& dst) {
+		// block offsets: 0 top-left, 1 top-right, 2 bottom-left, 3 bottom-right
+		switch (pattern) {
+		case BayerPattern::BAYER_RGGB:
+			binHalf<T, Sum, 0, 3>(raw, dst);
+			break;
+		case BayerPattern::BAYER_BGGR:
+			binHalf<T, Sum, 3, 0>(raw, dst);
+			break;
+		case BayerPattern::BAYER_GRBG:
+			binHalf<T, Sum, 1, 2>(raw, dst);
+			break;
+		case BayerPattern::BAYER_GBRG:
+			binHalf<T, Sum, 2, 1>(raw, dst);
+			break;
+		default:
+			break;
+		}
+	}
+
+
+	int colorCode(BayerPattern pattern, bool gray) {
+		switch (pattern) {
+		case BayerPattern::BAYER_RGGB:
+			return gray ? cv::COLOR_BayerBG2GRAY : cv::COLOR_BayerBG2BGR;
+		case BayerPattern::BAYER_BGGR:
+			return gray ? cv::COLOR_BayerRG2GRAY : cv::COLOR_BayerRG2BGR;
+		case BayerPattern::BAYER_GRBG:
+			return gray ? cv::COLOR_BayerGB2GRAY : cv::COLOR_BayerGB2BGR;
+		case BayerPattern::BAYER_GBRG:
+			return gray ? cv::COLOR_BayerGR2GRAY : cv::COLOR_BayerGR2BGR;
+		default:
+			return -1;
+		}
+	}
+}
+
+
+bool demosaic(const cv::Mat& raw, BayerPattern pattern, DemosaicMode mode, cv::Mat& dst) {
+	if (pattern == BayerPattern::BAYER_NONE || raw.empty() || raw.channels() != 1 || (raw.depth() != CV_8U && raw.depth() != CV_16U))
+		return false;
+
+	MVC_TRACE_SCOPE("demosaic");
+	if (mode == DemosaicMode::DEMOSAIC_HALF) {
+		dst.create(raw.rows / 2, raw.cols / 2, CV_MAKETYPE(raw.depth(), 3));
+		if (raw.depth() == CV_8U)
+			binHalf<uchar, int>(raw, pattern, dst);
+		else
+			binHalf<ushort, int>(raw, pattern, dst);
+	}
+	else {
+		cv::cvtColor(raw, dst, colorCode(pattern, mode == DemosaicMode::DEMOSAIC_GRAY));
+	}
+
+	return true;
+}
@@ -0,0 +1,22 @@
+#ifndef DEMOSAIC_H_
+#define DEMOSAIC_H_
+
+
+#ifndef __cplusplus
+#  error Demosaic.hpp header must be compiled as C++
+#endif
+
+#include "opencv2/opencv.hpp"
+#include "BayerPattern.hpp"
+
+
+/**
+ * @brief   Converts a 1 channel 8 or 16 bit mosaic to BGR or gray, in the format of the mode.
+ * @note    The full and gray modes are the bilinear SIMD kernels of cv::cvtColor. The half mode bins
+ *          every 2x2 block into one pixel, the two greens averaged, without any interpolation.
+ *          dst is reallocated only when its format changes. False for a frame that is not a mosaic.
+ */
+bool demosaic(const cv::Mat& raw, BayerPattern pattern, DemosaicMode mode, cv::Mat& dst);
+
+
+#endif // !DEMOSAIC_H_
@@ -0,0 +1,151 @@
+#include "DeviceCapsCache.hpp"
+
+#include <cmath>
+
+#include "boost/filesystem.hpp"
+namespace fs = boost::filesystem;
+
+
+DeviceCapsCache::DeviceCapsCache() {
+}
+
+
+DeviceCapsCache::~DeviceCapsCache() {
+}
+
+
+bool DeviceCapsCache::load(const std::string& filename) {
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	mFilename = filename;
+	mDevices.clear();
+
+	if (!fs::exists(filename))
+		return false;
+
+	cv::FileStorage fsCache(filename, cv::FileStorage::READ);
+	if (!fsCache.isOpened())
+		return false;
+
+	cv::FileNode devices = fsCache["devices"];
+	for (auto it = devices.begin(); it != devices.end(); ++it) {
+		cv::FileNode node = *it;
+		std::string key;
+		std::vector<double> last, modes;
+		node["key"] >> key;
+		node["last"] >> last;
+		node["modes"] >> modes;
+
+		// every mode is stored as [fourcc, width, height, fps]
+		DeviceCaps caps;
+		for (size_t i = 0; i + 3 < modes.size(); i += 4) {
+			DeviceMode mode;
+			mode.fourcc = (int)modes[i];
+			mode.resolution = { (int)modes[i + 1], (int)modes[i + 2] };
+			mode.fps = modes[i + 3];
+			caps.modes.push_back(mode);
+		}
+		if (last.size() == 4) {
+			caps.last.fourcc = (int)last[0];
+			caps.last.resolution = { (int)last[1], (int)last[2] };
+			caps.last.fps = last[3];
+		}
+		if (!key.empty())
+			mDevices[key] = caps;
+	}
+
+	return true;
+}
+
+
+bool DeviceCapsCache::save(const std::string& filename) const {
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	std::string path = filename.empty() ? mFilename : filename;
+	if (path.empty())
+		return false;
+
+	cv::FileStorage fsCache(path, cv::FileStorage::WRITE);
+	if (!fsCache.isOpened())
+		return false;
+
+	fsCache << "devices" << "[";
+	for (const auto& device : mDevices) {
+		const DeviceMode& last = device.second.last;
+		std::vector<double> modes;
+		for (const auto& mode : device.second.modes) {
+			modes.insert(modes.end(), { (double)mode.fourcc, (double)mode.resolution.width, (double)mode.resolution.height, mode.fps });
+		}
+
+		fsCache << "{";
+		fsCache << "key" << device.first;
+		fsCache << "last" << std::vector<double>{ (double)last.fourcc, (double)last.resolution.width, (double)last.resolution.height, last.fps };
+		fsCache << "modes" << modes;
+		fsCache << "}";
+	}
+	fsCache << "]";
+
+	return true;
+}
+
+
+bool DeviceCapsCache::lookup(const std::string& key, cv::Size resolution, double fps, DeviceMode& mode) const {
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	auto device = mDevices.find(key);
+	if (device == mDevices.end())
+		return false;
+
+	// without a target, the device comes up in the mode it was left in.
+	if (resolution.width <= 0 || resolution.height <= 0) {
+		mode = device->second.last;
+		return mode.resolution.width > 0 && mode.resolution.height > 0;
+	}
+
+	for (const auto& known : device->second.modes) {
+		if (known.resolution == resolution && std::fabs(known.fps - fps) < 0.5) {
+			mode = known;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void DeviceCapsCache::record(const std::string& key, const DeviceMode& mode) {
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	DeviceCaps& caps = mDevices[key];
+	caps.last = mode;
+
+	for (auto& known : caps.modes) {
+		if (known.resolution == mode.resolution && std::fabs(known.fps - mode.fps) < 0.5) {
+			known = mode;
+			return;
+		}
+	}
+	caps.modes.push_back(mode);
+}
+
+
+void DeviceCapsCache::forget(const std::string& key) {
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	mDevices.erase(key);
+}
+
+
+std::string DeviceCapsCache::deviceKey(int index, int apiPreference) {
+#ifdef __linux__
+	// the by-id links carry the vendor, model and serial number of the device.
+	fs::path device = "/dev/video" + std::to_string(index);
+	fs::path byId = "/dev/v4l/by-id";
+	boost::system::error_code ec;
+	if (fs::is_directory(byId, ec)) {
+		for (fs::directory_iterator it(byId, ec), end; it != end; it.increment(ec)) {
+			if (fs::canonical(it->path(), ec) == device)
+				return it->path().string();
+		}
+	}
+	if (fs::exists(device, ec))
+		return device.string();
+#endif
+
+	return "index:" + std::to_string(index) + ":" + std::to_string(apiPreference);
+}
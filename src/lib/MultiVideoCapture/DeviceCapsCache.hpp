@@ -0,0 +1,56 @@
+#ifndef DEVICE_CAPS_CACHE_H_
+#define DEVICE_CAPS_CACHE_H_
+
+
+#ifndef __cplusplus
+#  error DeviceCapsCache.hpp header must be compiled as C++
+#endif
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+
+
+struct DeviceMode {
+	int fourcc = 0;
+	cv::Size resolution = { 0, 0 };
+	double fps = 0.0;
+};
+
+
+struct DeviceCaps {
+	std::vector<DeviceMode> modes;	// modes the device was running with
+	DeviceMode last;
+};
+
+
+/**
+ * @brief   Capture modes known to work on each device, persisted between runs.
+ * @note    Devices are keyed by their /dev/v4l/by-id path when there is one, which holds
+ *          the serial number, otherwise by their index and backend.
+ */
+class DeviceCapsCache {
+public:
+	DeviceCapsCache();
+	virtual ~DeviceCapsCache();
+
+	virtual bool load(const std::string& filename);
+	virtual bool save(const std::string& filename = std::string()) const;
+
+	virtual bool lookup(const std::string& key, cv::Size resolution, double fps, DeviceMode& mode) const;
+	virtual void record(const std::string& key, const DeviceMode& mode);
+	virtual void forget(const std::string& key);
+
+	static std::string deviceKey(int index, int apiPreference);
+
+protected:
+	std::string mFilename;
+	std::map<std::string, DeviceCaps> mDevices;
+	mutable std::mutex mMtxCache;
+};
+
+
+#endif // !DEVICE_CAPS_CACHE_H_
@@ -0,0 +1,198 @@
+#include "EncoderStage.hpp"
+
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+#include "Trace.hpp"
+#include "boost/filesystem.hpp"
+namespace fs = boost::filesystem;
+
+
+EncoderStage::EncoderStage(size_t cameras, const EncoderSettings& settings) {
+	mSettings = settings;
+	mSettings.queueDepth = std::max<size_t>(1, mSettings.queueDepth);
+	mVerbose = false;
+
+	boost::system::error_code ec;
+	fs::create_directories(mSettings.directory, ec);
+
+	for (size_t i = 0; i < cameras; i++) {
+		mEncoders.emplace_back(new Encoder(mSettings.queueDepth));
+		mEncoders.back()->segmentFrames = 0;
+		mEncoders.back()->bayer = BayerPattern::BAYER_NONE;
+	}
+	for (size_t i = 0; i < cameras; i++) {
+		mEncoders[i]->worker = std::thread(&EncoderStage::encode, this, i);
+	}
+}
+
+
+EncoderStage::~EncoderStage() {
+	// the queued frames are still written
+	for (auto& encoder : mEncoders) {
+		encoder->queue.finish();
+	}
+	for (auto& encoder : mEncoders) {
+		if (encoder->worker.joinable())
+			encoder->worker.join();
+		encoder->writer.release();
+	}
+}
+
+
+bool EncoderStage::process(size_t camera, FrameType& frame) {
+	if (camera >= mEncoders.size())
+		return true;
+
+	Encoder& encoder = *mEncoders[camera];
+	if (encoder.queue.size() >= encoder.queue.capacity()) {
+		std::lock_guard<std::mutex> lock(encoder.mtxStats);
+		encoder.stats.framesDropped++;
+		return true;
+	}
+
+	// the capture reuses the pixels of the frame, the encoder gets its own copy from the pool
+	FrameType copy;
+	{
+		std::lock_guard<std::mutex> lock(encoder.mtxPool);
+		if (!encoder.pool.empty()) {
+			copy.mat() = encoder.pool.back();
+			encoder.pool.pop_back();
+		}
+	}
+	bool raw = frame.isRaw() && mSettings.rawFourcc != 0;
+	(raw || !frame.isRaw() ? frame.mat() : frame.color()).copyTo(copy.mat());
+	copy.setTimestamp(frame.timestamp());
+	copy.setPosition(frame.position());
+	copy.setBayer(raw ? frame.bayer() : BayerPattern::BAYER_NONE);
+
+	if (!encoder.queue.tryPush(copy)) {
+		std::lock_guard<std::mutex> lock(encoder.mtxStats);
+		encoder.stats.framesDropped++;
+	}
+
+	return true;
+}
+
+
+std::vector<EncoderStats> EncoderStage::stats() const {
+	std::vector<EncoderStats> res(mEncoders.size());
+	for (size_t i = 0; i < mEncoders.size(); i++) {
+		std::lock_guard<std::mutex> lock(mEncoders[i]->mtxStats);
+		res[i] = mEncoders[i]->stats;
+		res[i].queued = mEncoders[i]->queue.size();
+	}
+
+	return res;
+}
+
+
+void EncoderStage::verbose(bool verbose) {
+	mVerbose = verbose;
+}
+
+
+void EncoderStage::encode(size_t camera) {
+	MVC_TRACE_THREAD_NAME("encoder");
+	Encoder& encoder = *mEncoders[camera];
+
+	FrameType frame;
+	while (encoder.queue.pop(frame)) {
+		MVC_TRACE_SCOPE_ARG("enc.write", (int)camera);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		bool written = rotate(camera, frame);
+		if (written) {
+			encoder.writer.write(frame.mat());
+			encoder.segmentFrames++;
+		}
+
+		double msec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		double latency = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - frame.timestamp()).count();
+		{
+			std::lock_guard<std::mutex> lock(encoder.mtxStats);
+			EncoderStats& stats = encoder.stats;
+			if (written) {
+				stats.framesEncoded++;
+				stats.encodeMsec += (msec - stats.encodeMsec) / stats.framesEncoded;
+				stats.encodeMaxMsec = std::max(stats.encodeMaxMsec, msec);
+				stats.latencyMsec += (latency - stats.latencyMsec) / stats.framesEncoded;
+			}
+			else {
+				stats.framesDropped++;
+			}
+		}
+
+		// the buffer goes back to the pool once nobody else refers to it
+		std::lock_guard<std::mutex> lock(encoder.mtxPool);
+		const cv::Mat& mat = frame.mat();
+		if (mat.u && mat.u->refcount == 1 && encoder.pool.size() <= mSettings.queueDepth) {
+			encoder.pool.push_back(mat);
+		}
+		frame.mat() = cv::Mat();
+	}
+}
+
+
+bool EncoderStage::rotate(size_t camera, FrameType& frame) {
+	Encoder& encoder = *mEncoders[camera];
+	const cv::Mat& mat = frame.mat();
+
+	bool open = encoder.writer.isOpened();
+	if (open && (mat.size() != encoder.frameSize || frame.bayer() != encoder.bayer)) {
+		open = false;	// e.g. a new ROI
+	}
+	if (open && mSettings.segmentSeconds > 0.0 &&
+		std::chrono::duration<double>(frame.timestamp() - encoder.segmentStart).count() >= mSettings.segmentSeconds) {
+		open = false;
+	}
+	if (open && mSettings.segmentBytes > 0 && encoder.segmentFrames % 30 == 0) {
+		boost::system::error_code ec;
+		boost::uintmax_t bytes = fs::file_size(encoder.filename, ec);
+		if (!ec && bytes >= mSettings.segmentBytes)
+			open = false;
+	}
+	if (open)
+		return true;
+
+	encoder.writer.release();
+	encoder.segmentStart = frame.timestamp();
+	encoder.filename = segmentName(camera, encoder.segmentStart, frame.bayer());
+	encoder.frameSize = mat.size();
+	encoder.bayer = frame.bayer();
+	encoder.segmentFrames = 0;
+
+	int fourcc = frame.isRaw() ? mSettings.rawFourcc : mSettings.fourcc;
+	bool status = encoder.writer.open(encoder.filename, mSettings.apiPreference, fourcc, mSettings.fps, mat.size(), mat.channels() != 1);
+	if (status) {
+		std::lock_guard<std::mutex> lock(encoder.mtxStats);
+		encoder.stats.segments++;
+	}
+	if (mVerbose) {
+		std::lock_guard<std::mutex> lock(mMtxMsg);
+		std::cout << (status ? "recording to " : "cannot open ") << encoder.filename << std::endl;
+	}
+
+	return status;
+}
+
+
+std::string EncoderStage::segmentName(size_t camera, std::chrono::system_clock::time_point start, BayerPattern bayer) const {
+	std::time_t t = std::chrono::system_clock::to_time_t(start);
+	std::tm tm;
+#ifdef _WIN32
+	localtime_s(&tm, &t);
+#else
+	localtime_r(&t, &tm);
+#endif
+
+	std::ostringstream name;
+	name << mSettings.prefix << "cam" << camera << "_" << std::put_time(&tm, "%Y%m%d-%H%M%S")
+		<< "_" << std::setw(4) << std::setfill('0') << mEncoders[camera]->stats.segments;
+	if (bayer != BayerPattern::BAYER_NONE)
+		name << "_" << bayerName(bayer);
+	name << "." << mSettings.extension;
+
+	return (fs::path(mSettings.directory) / name.str()).string();
+}
@@ -0,0 +1,106 @@
+#ifndef ENCODER_STAGE_H_
+#define ENCODER_STAGE_H_
+
+
+#ifndef __cplusplus
+#  error EncoderStage.hpp header must be compiled as C++
+#endif
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+#include "FrameQueue.hpp"
+
+
+/**
+ * @brief   Output files of the EncoderStage.
+ * @note    A segment is closed when it gets older or bigger than the limits, 0 disables a limit.
+ *          The files are named <directory>/<prefix>cam<N>_<date>-<time>_<segment>.<extension>,
+ *          with _<pattern> before the extension for the raw mosaics.
+ *          A lossy codec would blur a mosaic: the raw frames are written with rawFourcc, or
+ *          demosaiced for fourcc when it is 0.
+ */
+struct EncoderSettings {
+	std::string directory = ".";
+	std::string prefix = "";
+	int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+	int rawFourcc = cv::VideoWriter::fourcc('F', 'F', 'V', '1');	// lossless
+	std::string extension = "avi";
+	int apiPreference = cv::CAP_FFMPEG;
+	double fps = 30.0;	// of the written streams
+	double segmentSeconds = 300.0;
+	size_t segmentBytes = 0;
+	size_t queueDepth = 8;	// frames waiting per camera before new ones are dropped
+};
+
+
+/**
+ * @brief   Counters of the encoder of a single camera.
+ */
+struct EncoderStats {
+	unsigned long long framesEncoded = 0;
+	unsigned long long framesDropped = 0;	// the queue was full or no file could be opened
+	unsigned long long segments = 0;
+	size_t queued = 0;
+	double encodeMsec = 0.0;	// average time to write a frame
+	double encodeMaxMsec = 0.0;
+	double latencyMsec = 0.0;	// average from the grab to the frame written
+};
+
+
+/**
+ * @brief   Stage writing every camera to compressed video files, one encoder thread per camera.
+ * @note    process() copies the frame into a pooled buffer and queues it without blocking,
+ *          a frame arriving while the queue is full is dropped and counted.
+ *          The queued frames are written when the stage is destroyed.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS EncoderStage : public FrameStage {
+public:
+	EncoderStage(size_t cameras, const EncoderSettings& settings = EncoderSettings());
+	virtual ~EncoderStage();
+
+	virtual bool process(size_t camera, FrameType& frame);
+
+	virtual std::vector<EncoderStats> stats() const;
+	virtual void verbose(bool verbose = false);
+
+protected:
+	struct Encoder {
+		Encoder(size_t depth) : queue(depth) {}
+
+		FrameQueue queue;
+		std::thread worker;
+
+		std::mutex mtxPool;
+		std::vector<cv::Mat> pool;	// buffers back from the encoder
+
+		cv::VideoWriter writer;
+		std::string filename;
+		cv::Size frameSize;
+		BayerPattern bayer;	// of the segment
+		std::chrono::system_clock::time_point segmentStart;
+		unsigned long long segmentFrames;
+
+		mutable std::mutex mtxStats;
+		EncoderStats stats;
+	};
+
+	virtual void encode(size_t camera);
+	virtual bool rotate(size_t camera, FrameType& frame);
+	virtual std::string segmentName(size_t camera, std::chrono::system_clock::time_point start, BayerPattern bayer) const;
+
+protected:
+	EncoderSettings mSettings;
+	std::vector<std::unique_ptr<Encoder> > mEncoders;
+	bool mVerbose;
+	std::mutex mMtxMsg;
+};
+
+
+#endif // !ENCODER_STAGE_H_
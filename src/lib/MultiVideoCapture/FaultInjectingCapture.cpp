@@ -0,0 +1,262 @@
+#include "FaultInjectingCapture.hpp"
+
+#include <thread>
+
+
+FaultInjectingCapture::FaultInjectingCapture(VideoCaptureType* source, const FaultProfile& profile) {
+	mSource = source;
+	mGrabCount = 0;
+	mOpenFailures = 0;
+	mVanished = false;
+	setProfile(profile);
+}
+
+
+FaultInjectingCapture::~FaultInjectingCapture() {
+	this->release();
+	delete mSource;
+}
+
+
+bool FaultInjectingCapture::open(const std::string& filename) {
+	if (mStatus != CamStatus::CAM_STATUS_CLOSED)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		mStatus = CamStatus::CAM_STATUS_OPENING;
+	}
+	checkOpenFault("The file (" + filename + ") cannot be opened");
+
+	bool status = false;
+	try {
+		status = mSource->open(filename);
+	}
+	catch (...) {
+		openDone(false);
+		throw;
+	}
+
+	return openDone(status);
+}
+
+
+bool FaultInjectingCapture::open(int index, int apiPreference) {
+	if (mStatus != CamStatus::CAM_STATUS_CLOSED)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		mStatus = CamStatus::CAM_STATUS_OPENING;
+	}
+	mCamId = index;
+	checkOpenFault("can't open a camera " + std::to_string(index));
+
+	bool status = false;
+	try {
+		status = mSource->open(index, apiPreference);
+	}
+	catch (...) {
+		openDone(false);
+		throw;
+	}
+
+	return openDone(status);
+}
+
+
+void FaultInjectingCapture::release() {
+	mSource->release();
+	VideoCaptureType::release();
+}
+
+
+bool FaultInjectingCapture::grab() {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long count = mGrabCount++;
+
+	if (mVanished) {
+		countGrab(false, start);
+		return false;
+	}
+
+	if (mProfile.hangAt >= 0 && count == mProfile.hangAt) {
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(mProfile.hangMsec));
+	}
+	if (mProfile.slowGrabRate > 0.0 && random() < mProfile.slowGrabRate) {
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(mProfile.slowGrabMsec));
+	}
+
+	if (mProfile.disconnectAt >= 0 && count >= mProfile.disconnectAt) {
+		// the device is gone until it is opened again.
+		mVanished = true;
+		mVanishedAt = std::chrono::steady_clock::now();
+		mSource->release();
+		{
+			std::lock_guard<std::mutex> lock(mMtxStatus);
+			mStatus = CamStatus::CAM_STATUS_CLOSED;
+		}
+		if (mVerbose) {
+			std::lock_guard<std::mutex> lock(mMtxMsg);
+			std::cout << "camera " << mCamId << " is disconnected" << std::endl;
+		}
+		countGrab(false, start);
+		return false;
+	}
+
+	bool res = mSource->grab();
+	countGrab(res, start);
+
+	return res;
+}
+
+
+bool FaultInjectingCapture::retrieve(FrameType& frame, int flag) {
+	if (mVanished)
+		return false;
+
+	return mSource->retrieve(frame, flag);
+}
+
+
+bool FaultInjectingCapture::seek(double msec) {
+	if (mVanished)
+		return false;
+
+	bool res = mSource->seek(msec);
+	if (res) {
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		mStatus = mSource->status();
+	}
+
+	return res;
+}
+
+
+bool FaultInjectingCapture::set(int propId, double value) {
+	return mSource->set(propId, value);
+}
+
+
+bool FaultInjectingCapture::set(cv::Size resolution, float fps) {
+	return mSource->set(resolution, fps);
+}
+
+
+double FaultInjectingCapture::get(int propId) const {
+	return mSource->get(propId);
+}
+
+
+void FaultInjectingCapture::setTarget(cv::Size resolution, float fps) {
+	mSource->setTarget(resolution, fps);
+}
+
+
+void FaultInjectingCapture::setCapsCache(DeviceCapsCache* cache) {
+	mSource->setCapsCache(cache);
+}
+
+
+void FaultInjectingCapture::setAllocator(cv::MatAllocator* allocator) {
+	mSource->setAllocator(allocator);
+}
+
+
+size_t FaultInjectingCapture::frameBytes(bool cropped) const {
+	return mSource->frameBytes(cropped);
+}
+
+
+bool FaultInjectingCapture::setRoi(cv::Rect roi, int decimation) {
+	mRoi = roi;
+	mDecimation = decimation > 1 ? decimation : 1;
+
+	return mSource->setRoi(roi, decimation);
+}
+
+
+void FaultInjectingCapture::setDeduplication(DedupMode mode) {
+	mDedup = mode;
+	mSource->setDeduplication(mode);
+}
+
+
+void FaultInjectingCapture::setRaw(BayerPattern pattern) {
+	mBayer = pattern;
+	mSource->setRaw(pattern);
+}
+
+
+CameraStats FaultInjectingCapture::stats() const {
+	// the faults are counted here, the duplicates and the undecoded grabs by the source
+	CameraStats res = VideoCaptureType::stats();
+	CameraStats source = mSource->stats();
+	res.framesDuplicate = source.framesDuplicate;
+	res.staleMsec = source.staleMsec;
+	res.framesUndecoded = source.framesUndecoded;
+
+	return res;
+}
+
+
+void FaultInjectingCapture::setProfile(const FaultProfile& profile) {
+	mProfile = profile;
+	mRng.seed(profile.seed);
+	mOpenFailures = 0;
+}
+
+
+FaultProfile FaultInjectingCapture::profile() const {
+	return mProfile;
+}
+
+
+void FaultInjectingCapture::verbose(bool verbose) {
+	mVerbose = verbose;
+	mSource->verbose(verbose);
+}
+
+
+void FaultInjectingCapture::checkOpenFault(const std::string& msg) {
+	bool fail = false;
+	if (mOpenFailures < mProfile.openFailures) {
+		mOpenFailures++;
+		fail = true;
+	}
+	else if (mVanished) {
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mVanishedAt;
+		fail = elapsed.count() < mProfile.reconnectMsec;
+	}
+
+	if (fail) {
+		{
+			std::lock_guard<std::mutex> lock(mMtxStatus);
+			mStatus = CamStatus::CAM_STATUS_CLOSED;
+		}
+		std::lock_guard<std::mutex> lock(mMtxMsg);
+		if (mVerbose) {
+			std::cout << msg << " (injected)" << std::endl;
+		}
+		throw std::runtime_error(msg);
+	}
+}
+
+
+bool FaultInjectingCapture::openDone(bool status) {
+	if (status) {
+		mVanished = false;
+		mGrabCount = 0;
+		countOpen();
+	}
+
+	std::lock_guard<std::mutex> lock(mMtxStatus);
+	mStatus = status ? mSource->status() : CamStatus::CAM_STATUS_CLOSED;
+
+	return status;
+}
+
+
+double FaultInjectingCapture::random() {
+	return (double)mRng() / ((double)std::mt19937::max() + 1.0);
+}
@@ -0,0 +1,84 @@
+#ifndef FAULT_INJECTING_CAPTURE_H_
+#define FAULT_INJECTING_CAPTURE_H_
+
+
+#ifndef __cplusplus
+#  error FaultInjectingCapture.hpp header must be compiled as C++
+#endif
+
+#include <chrono>
+#include <random>
+
+#include "VideoCaptureType.hpp"
+
+
+/**
+ * @brief   Faults injected by FaultInjectingCapture. Grab counts start from 0 at every open.
+ */
+struct FaultProfile {
+	double slowGrabMsec = 0.0;	// delay added to a slowed grab
+	double slowGrabRate = 0.0;	// probability that a grab is slowed [0, 1]
+	long long hangAt = -1;	// grab count at which the grab hangs. -1 for never
+	double hangMsec = 0.0;	// duration of the hang
+	int openFailures = 0;	// number of open attempts failing before the first success
+	long long disconnectAt = -1;	// grab count at which the device vanishes. -1 for never
+	double reconnectMsec = 0.0;	// the device can't be opened for this long after vanishing
+	unsigned int seed = 0;
+};
+
+
+/**
+ * @brief   Wraps any frame source and injects slow grabs, hangs, open failures and disconnects.
+ * @note    The wrapper owns the source. Faults go through the same status changes
+ *          and exceptions as a real device, so the recovery paths can be exercised.
+ */
+class FaultInjectingCapture : public VideoCaptureType {
+public:
+	FaultInjectingCapture(VideoCaptureType* source, const FaultProfile& profile = FaultProfile());
+	virtual ~FaultInjectingCapture();
+
+	using VideoCaptureType::open;
+	virtual bool open(const std::string& filename);
+	virtual bool open(int index, int apiPreference);
+
+	virtual void release();
+
+	virtual bool grab();
+	virtual bool retrieve(FrameType& frame, int flag = 0);
+
+	virtual bool seek(double msec);
+	virtual bool set(int propId, double value);
+	virtual bool set(cv::Size resolution = { -1, -1 }, float fps = -1.f);
+	virtual double get(int propId) const;
+	virtual void setTarget(cv::Size resolution, float fps);
+	virtual void setCapsCache(DeviceCapsCache* cache);
+	virtual void setAllocator(cv::MatAllocator* allocator);
+	virtual size_t frameBytes(bool cropped = true) const;
+	virtual bool setRoi(cv::Rect roi = cv::Rect(), int decimation = 1);
+	virtual void setDeduplication(DedupMode mode);
+	virtual void setRaw(BayerPattern pattern);
+	virtual CameraStats stats() const;
+
+	virtual void setProfile(const FaultProfile& profile);
+	virtual FaultProfile profile() const;
+
+	virtual void verbose(bool verbose = false);
+
+protected:
+	virtual void checkOpenFault(const std::string& msg);
+	virtual bool openDone(bool status);
+	virtual double random();
+
+protected:
+	VideoCaptureType* mSource;
+	FaultProfile mProfile;
+	std::mt19937 mRng;
+
+	long long mGrabCount;
+	int mOpenFailures;
+	bool mVanished;
+	std::chrono::steady_clock::time_point mVanishedAt;
+};
+
+
+#endif // !FAULT_INJECTING_CAPTURE_H_
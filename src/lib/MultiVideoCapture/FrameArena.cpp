@@ -0,0 +1,249 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+
+namespace {
+	const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	const size_t SLOT_ALIGNMENT = 4096;	// every slot starts on its own page
+
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+FrameArena::FrameArena(const std::vector<ArenaFormat>& formats) {
+	mRegion = NULL;
+	mRegionBytes = 0;
+	mMapping = NULL;
+	mMappingBytes = 0;
+	mHugePages = false;
+	mSlots = 0;
+	mInUse = 0;
+	mPeakInUse = 0;
+	mBytesInUse = 0;
+	mFallbacks = 0;
+	mRetired = false;
+
+	// formats of the same size share their slots
+	for (const auto& format : formats) {
+		if (format.bytes == 0 || format.slots == 0)
+			continue;
+		size_t bytes = alignUp(format.bytes, SLOT_ALIGNMENT);
+		auto it = std::find_if(mClasses.begin(), mClasses.end(), [bytes](const SlotClass& c) { return c.bytes == bytes; });
+		if (it == mClasses.end()) {
+			mClasses.push_back(SlotClass());
+			it = mClasses.end() - 1;
+			it->bytes = bytes;
+			it->count = 0;
+		}
+		it->count += format.slots;
+		mRegionBytes += bytes * format.slots;
+		mSlots += format.slots;
+	}
+	std::sort(mClasses.begin(), mClasses.end(), [](const SlotClass& a, const SlotClass& b) { return a.bytes < b.bytes; });
+
+	if (mRegionBytes == 0 || !reserve(mRegionBytes)) {
+		mClasses.clear();
+		mRegionBytes = 0;
+		mSlots = 0;
+		return;
+	}
+
+	// carve the slots, the free lists are popped from the back
+	unsigned char* slot = mRegion;
+	for (auto& slotClass : mClasses) {
+		slotClass.free.resize(slotClass.count);
+		for (size_t i = slotClass.count; i > 0; i--) {
+			slotClass.free[i - 1] = slot;
+			slot += slotClass.bytes;
+		}
+	}
+}
+
+
+FrameArena::~FrameArena() {
+	unreserve();
+}
+
+
+void FrameArena::retire() {
+	std::lock_guard<std::mutex> lock(mMtxArena);
+	mRetired = true;
+	if (mInUse == 0)
+		unreserve();	// otherwise the last deallocate() does
+}
+
+
+ArenaStats FrameArena::stats() const {
+	std::lock_guard<std::mutex> lock(mMtxArena);
+	ArenaStats res;
+	res.reservedBytes = mRegionBytes;
+	res.hugePages = mHugePages;
+	res.slots = mSlots;
+	res.slotsInUse = mInUse;
+	res.peakSlotsInUse = mPeakInUse;
+	res.bytesInUse = mBytesInUse;
+	res.fallbacks = mFallbacks;
+
+	return res;
+}
+
+
+bool FrameArena::isReserved() const {
+	return mRegion != NULL;
+}
+
+
+cv::UMatData* FrameArena::allocate(int dims, const int* sizes, int type, void* data, size_t* step, ArenaAccessFlag flags, cv::UMatUsageFlags usageFlags) const {
+	if (data != NULL)
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+	// continuous layout, same as the default allocator
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; i--) {
+		if (step)
+			step[i] = total;
+		total *= sizes[i];
+	}
+
+	unsigned char* slot = NULL;
+	{
+		std::lock_guard<std::mutex> lock(mMtxArena);
+		for (auto& slotClass : mClasses) {
+			if (!mRetired && slotClass.bytes >= total && !slotClass.free.empty()) {
+				slot = slotClass.free.back();
+				slotClass.free.pop_back();
+				break;
+			}
+		}
+		if (slot == NULL) {
+			mFallbacks++;
+		}
+		else {
+			mInUse++;
+			mPeakInUse = std::max(mPeakInUse, mInUse);
+			mBytesInUse += total;
+		}
+	}
+	if (slot == NULL)
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+	cv::UMatData* u = new cv::UMatData(this);
+	u->data = u->origdata = slot;
+	u->size = total;
+
+	return u;
+}
+
+
+bool FrameArena::allocate(cv::UMatData* data, ArenaAccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const {
+	return data != NULL;
+}
+
+
+void FrameArena::deallocate(cv::UMatData* data) const {
+	if (data == NULL)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMtxArena);
+		if (!owns(data->origdata)) {
+			cv::Mat::getStdAllocator()->deallocate(data);
+			return;
+		}
+
+		size_t offset = data->origdata - mRegion;
+		size_t first = 0;
+		for (auto& slotClass : mClasses) {
+			size_t end = first + slotClass.bytes * slotClass.count;
+			if (offset < end) {
+				slotClass.free.push_back(data->origdata);
+				break;
+			}
+			first = end;
+		}
+		mInUse--;
+		mBytesInUse -= data->size;
+		if (mRetired && mInUse == 0)
+			unreserve();
+	}
+	delete data;
+}
+
+
+bool FrameArena::reserve(size_t bytes) {
+#ifdef _WIN32
+	// large pages need the SeLockMemoryPrivilege, regular pages are committed up front
+	mMapping = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (mMapping == NULL)
+		return false;
+	mMappingBytes = bytes;
+	mRegion = static_cast<unsigned char*>(mMapping);
+#else
+	size_t length = alignUp(bytes, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+	// explicit huge pages, only when the administrator reserved enough of them
+	void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (ptr != MAP_FAILED) {
+		mMapping = ptr;
+		mMappingBytes = length;
+		mRegion = static_cast<unsigned char*>(ptr);
+		mHugePages = true;
+	}
+#endif
+
+	if (mRegion == NULL) {
+		// over-map so the region starts on a huge page boundary
+		size_t mapping = length + HUGE_PAGE_SIZE;
+		void* ptr = mmap(NULL, mapping, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED)
+			return false;
+		mMapping = ptr;
+		mMappingBytes = mapping;
+		mRegion = reinterpret_cast<unsigned char*>(alignUp(reinterpret_cast<size_t>(ptr), HUGE_PAGE_SIZE));
+
+#ifdef MADV_HUGEPAGE
+		mHugePages = madvise(mRegion, length, MADV_HUGEPAGE) == 0;
+#endif
+	}
+#endif
+
+	// fault the pages in now rather than on the first frames
+	const size_t page = 4096;
+	for (size_t offset = 0; offset < bytes; offset += page) {
+		mRegion[offset] = 0;
+	}
+
+	return true;
+}
+
+
+void FrameArena::unreserve() const {
+	if (mMapping == NULL)
+		return;
+
+#ifdef _WIN32
+	VirtualFree(mMapping, 0, MEM_RELEASE);
+#else
+	munmap(mMapping, mMappingBytes);
+#endif
+	mMapping = NULL;
+	mMappingBytes = 0;
+	mRegion = NULL;
+}
+
+
+bool FrameArena::owns(const void* ptr) const {
+	const unsigned char* p = static_cast<const unsigned char*>(ptr);
+	return mRegion != NULL && p >= mRegion && p < mRegion + mRegionBytes;
+}
@@ -0,0 +1,84 @@
+#ifndef FRAME_ARENA_H_
+#define FRAME_ARENA_H_
+
+
+#ifndef __cplusplus
+#  error FrameArena.hpp header must be compiled as C++
+#endif
+
+#include <mutex>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "CaptureStats.hpp"
+
+
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag ArenaAccessFlag;
+#else
+typedef int ArenaAccessFlag;
+#endif
+
+
+/**
+ * @brief   Slot size and count of one camera format.
+ */
+struct ArenaFormat {
+	size_t bytes;
+	size_t slots;
+};
+
+
+/**
+ * @brief   Frame pixel allocator carving fixed-size slots out of one region reserved up front.
+ * @note    The region is backed by huge pages when the system has them (MAP_HUGETLB, then
+ *          transparent huge pages). A buffer takes the smallest free slot it fits in and falls
+ *          back to the default allocator when there is none.
+ *          Mats keep a pointer to their allocator and may outlive the owner, so the arena is
+ *          never deleted: retire() unmaps the region once the last slot comes back and later
+ *          buffers go to the default allocator.
+ */
+class FrameArena : public cv::MatAllocator {
+public:
+	FrameArena(const std::vector<ArenaFormat>& formats);
+
+	virtual void retire();
+	virtual ArenaStats stats() const;
+	virtual bool isReserved() const;
+
+	virtual cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, ArenaAccessFlag flags, cv::UMatUsageFlags usageFlags) const;
+	virtual bool allocate(cv::UMatData* data, ArenaAccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const;
+	virtual void deallocate(cv::UMatData* data) const;
+
+protected:
+	virtual ~FrameArena();	// see retire()
+
+	virtual bool reserve(size_t bytes);
+	virtual void unreserve() const;
+	virtual bool owns(const void* ptr) const;
+
+protected:
+	struct SlotClass {
+		size_t bytes;
+		size_t count;
+		std::vector<unsigned char*> free;
+	};
+
+	mutable unsigned char* mRegion;	// first slot, NULL once unmapped
+	size_t mRegionBytes;
+	mutable void* mMapping;	// start and length of the mapping, before alignment
+	mutable size_t mMappingBytes;
+	bool mHugePages;
+
+	mutable std::vector<SlotClass> mClasses;	// sorted by slot size
+	size_t mSlots;
+	mutable size_t mInUse;
+	mutable size_t mPeakInUse;
+	mutable size_t mBytesInUse;
+	mutable unsigned long long mFallbacks;
+	mutable bool mRetired;
+	mutable std::mutex mMtxArena;
+};
+
+
+#endif // !FRAME_ARENA_H_
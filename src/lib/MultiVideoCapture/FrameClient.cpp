@@ -0,0 +1,269 @@
+#include "FrameClient.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+
+FrameClient::FrameClient() {
+	mFd = -1;
+	mSequence = 0;
+	mMappings.resize(FrameWire::MAX_CAMERAS);
+	for (auto& mapping : mMappings) {
+		mapping.data = NULL;
+		mapping.bytes = 0;
+	}
+}
+
+
+FrameClient::~FrameClient() {
+	disconnect();
+}
+
+
+bool FrameClient::isConnected() const {
+	return mFd >= 0;
+}
+
+
+FrameClient& FrameClient::operator >> (std::vector<FrameType>& frames) {
+	read(frames);
+	return *this;
+}
+
+
+FrameClientStats FrameClient::stats() const {
+	return mStats;
+}
+
+
+#ifdef __linux__
+
+bool FrameClient::connect(const std::string& path, uint64_t cameras, double maxFps) {
+	disconnect();
+
+	sockaddr_un addr;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path))
+		return false;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	mFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (mFd < 0)
+		return false;
+	if (::connect(mFd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+		disconnect();
+		return false;
+	}
+	mSequence = 0;
+
+	return subscribe(cameras, maxFps);
+}
+
+
+bool FrameClient::subscribe(uint64_t cameras, double maxFps) {
+	if (mFd < 0)
+		return false;
+
+	FrameWire::FrameSubscription subscription;
+	subscription.magic = FrameWire::MAGIC;
+	subscription.reserved = 0;
+	subscription.cameras = cameras;
+	subscription.maxFps = maxFps;
+
+	return send(mFd, &subscription, sizeof(subscription), MSG_NOSIGNAL) == (ssize_t)sizeof(subscription);
+}
+
+
+void FrameClient::disconnect() {
+	if (mFd >= 0)
+		close(mFd);
+	mFd = -1;
+	for (size_t i = 0; i < mMappings.size(); i++) {
+		unmap(i);
+	}
+}
+
+
+bool FrameClient::read(std::vector<FrameType>& frames) {
+	if (mFd < 0)
+		return false;
+
+	const size_t MAX_FDS = FrameWire::MAX_CAMERAS;
+	std::vector<uint8_t> buffer(sizeof(FrameWire::FrameSetHeader) + FrameWire::MAX_CAMERAS * sizeof(FrameWire::FrameHeader));
+	std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_FDS));
+
+	iovec iov;
+	iov.iov_base = buffer.data();
+	iov.iov_len = buffer.size();
+	msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+
+	ssize_t size;
+	do {
+		size = recvmsg(mFd, &msg, MSG_CMSG_CLOEXEC);
+	} while (size < 0 && errno == EINTR);
+	if (size <= 0) {
+		disconnect();
+		return false;
+	}
+
+	std::vector<int> fds;
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			const int* received = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+			fds.insert(fds.end(), received, received + count);
+		}
+	}
+
+	FrameWire::FrameSetHeader set;
+	std::memcpy(&set, buffer.data(), std::min(sizeof(set), (size_t)size));
+	if ((size_t)size < sizeof(set) || set.magic != FrameWire::MAGIC ||
+		(size_t)size < sizeof(set) + set.count * sizeof(FrameWire::FrameHeader)) {
+		for (int fd : fds) {
+			close(fd);
+		}
+		return false;
+	}
+
+	mStats.sets++;
+	if (mSequence && set.sequence > mSequence + 1)
+		mStats.setsMissed += set.sequence - mSequence - 1;
+	mSequence = set.sequence;
+
+	size_t cameras = 0;
+	std::vector<FrameWire::FrameHeader> headers(set.count);
+	std::memcpy(headers.data(), buffer.data() + sizeof(set), set.count * sizeof(FrameWire::FrameHeader));
+	for (const auto& header : headers) {
+		cameras = std::max(cameras, (size_t)header.camera + 1);
+	}
+	if (frames.size() < cameras)
+		frames.resize(cameras);
+	std::vector<char> delivered(frames.size(), 0);
+
+	// every descriptor received is either mapped or closed
+	for (const auto& header : headers) {
+		if (header.fd >= 0 && (size_t)header.fd < fds.size() && header.camera < mMappings.size()) {
+			map(header.camera, fds[header.fd]);
+			fds[header.fd] = -1;
+		}
+	}
+	for (int fd : fds) {
+		if (fd >= 0)
+			close(fd);
+	}
+
+	for (const auto& header : headers) {
+		if (header.camera >= mMappings.size())
+			continue;
+		const Mapping& mapping = mMappings[header.camera];
+		size_t rowBytes = header.step;
+		size_t bytes = rowBytes * header.rows;
+		size_t offset = header.slot * header.slotStride;
+		if (mapping.data == NULL || offset + FrameWire::SLOT_HEADER_BYTES + bytes > mapping.bytes)
+			continue;
+
+		// copy, then make sure the server did not start writing the slot over meanwhile
+		const FrameWire::SlotHeader* slot = reinterpret_cast<const FrameWire::SlotHeader*>(mapping.data + offset);
+		if (slot->sequence.load(std::memory_order_acquire) != header.sequence) {
+			mStats.framesTorn++;
+			continue;
+		}
+		FrameType& frame = frames[header.camera];
+		frame.mat().create(header.rows, header.cols, header.type);
+		std::memcpy(frame.mat().data, mapping.data + offset + FrameWire::SLOT_HEADER_BYTES, bytes);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot->sequence.load(std::memory_order_relaxed) != header.sequence) {
+			mStats.framesTorn++;
+			continue;
+		}
+
+		frame.setTimestamp(std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(header.timestampNs))));
+		frame.setPosition(header.position);
+		frame.setBayer((BayerPattern)header.bayer);
+		delivered[header.camera] = 1;
+	}
+
+	// the cameras missing from the set, or torn, are delivered empty
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (!delivered[i])
+			frames[i].mat().release();
+	}
+
+	return true;
+}
+
+
+bool FrameClient::map(size_t camera, int fd) {
+	unmap(camera);
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	// the mapping keeps the memory
+	if (data == MAP_FAILED)
+		return false;
+
+	mMappings[camera].data = static_cast<uint8_t*>(data);
+	mMappings[camera].bytes = (size_t)info.st_size;
+
+	return true;
+}
+
+
+void FrameClient::unmap(size_t camera) {
+	Mapping& mapping = mMappings[camera];
+	if (mapping.data)
+		munmap(mapping.data, mapping.bytes);
+	mapping.data = NULL;
+	mapping.bytes = 0;
+}
+
+#else
+
+bool FrameClient::connect(const std::string& path, uint64_t cameras, double maxFps) {
+	return false;
+}
+
+
+bool FrameClient::subscribe(uint64_t cameras, double maxFps) {
+	return false;
+}
+
+
+void FrameClient::disconnect() {
+}
+
+
+bool FrameClient::read(std::vector<FrameType>& frames) {
+	return false;
+}
+
+
+bool FrameClient::map(size_t camera, int fd) {
+	return false;
+}
+
+
+void FrameClient::unmap(size_t camera) {
+}
+
+#endif	// __linux__
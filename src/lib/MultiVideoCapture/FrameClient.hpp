@@ -0,0 +1,63 @@
+#ifndef FRAME_CLIENT_H_
+#define FRAME_CLIENT_H_
+
+
+#ifndef __cplusplus
+#  error FrameClient.hpp header must be compiled as C++
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameType.hpp"
+#include "FrameServer.hpp"
+
+
+/**
+ * @brief   Counters of a FrameClient.
+ */
+struct FrameClientStats {
+	unsigned long long sets = 0;
+	unsigned long long setsMissed = 0;	// sent by the server while this client was not keeping up
+	unsigned long long framesTorn = 0;	// overwritten by the server while being copied, delivered empty
+};
+
+
+/**
+ * @brief   Reads the frame sets of a FrameServer running in another process.
+ * @note    Linux only, connect() returns false on other systems.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS FrameClient {
+public:
+	FrameClient();
+	virtual ~FrameClient();
+
+	virtual bool connect(const std::string& path, uint64_t cameras = ~0ull, double maxFps = 0.0);
+	virtual bool subscribe(uint64_t cameras, double maxFps = 0.0);	// bit i for camera i
+	virtual void disconnect();
+	virtual bool isConnected() const;
+
+	virtual bool read(std::vector<FrameType>& frames);	// waits for the next set, frames[i] for camera i
+	virtual FrameClient& operator >> (std::vector<FrameType>& frames);
+
+	virtual FrameClientStats stats() const;
+
+protected:
+	struct Mapping {
+		uint8_t* data;
+		size_t bytes;
+	};
+
+	virtual bool map(size_t camera, int fd);
+	virtual void unmap(size_t camera);
+
+protected:
+	int mFd;
+	std::vector<Mapping> mMappings;
+	uint64_t mSequence;
+	FrameClientStats mStats;
+};
+
+
+#endif // !FRAME_CLIENT_H_
@@ -0,0 +1,269 @@
+#include "FrameHistory.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Trace.hpp"
+#include "boost/filesystem.hpp"
+namespace fs = boost::filesystem;
+
+
+FrameHistory::FrameHistory(size_t cameras, const HistorySettings& settings) {
+	mSettings = settings;
+	mCameraBytes = cameras ? mSettings.maxBytes / cameras : 0;
+	for (size_t i = 0; i < cameras; i++) {
+		mRings.emplace_back(new Ring());
+		mRings.back()->bytes = 0;
+	}
+
+	mFlushing = false;
+	mStopFlush = false;
+	mEvicted = 0;
+	mFlushed = 0;
+	mFlushThread = std::thread(&FrameHistory::flushLoop, this);
+}
+
+
+FrameHistory::~FrameHistory() {
+	{
+		std::lock_guard<std::mutex> lock(mMtxFlush);
+		mStopFlush = true;
+	}
+	mCvFlush.notify_all();
+	if (mFlushThread.joinable())
+		mFlushThread.join();
+}
+
+
+bool FrameHistory::process(size_t camera, FrameType& frame) {
+	if (camera >= mRings.size() || frame.empty() || frame.isDuplicate())
+		return true;
+
+	MVC_TRACE_SCOPE_ARG("history.store", (int)camera);
+	Ring& ring = *mRings[camera];
+	Entry entry;
+	entry.timestamp = frame.timestamp();
+	entry.position = frame.position();
+	entry.bayer = frame.bayer();
+
+	if (mSettings.compressed) {
+		// the JPEG blocks would blur a mosaic, a raw frame is demosaiced first
+		entry.jpeg = std::make_shared<std::vector<uchar> >();
+		entry.bayer = BayerPattern::BAYER_NONE;
+		std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, mSettings.jpegQuality };
+		if (!cv::imencode(".jpg", frame.color(), *entry.jpeg, params))
+			return true;
+		entry.bytes = entry.jpeg->size();
+	}
+	else {
+		// the copy reuses an evicted buffer, the encoding is done outside of the lock
+		{
+			std::lock_guard<std::mutex> lock(ring.mtx);
+			if (!ring.pool.empty()) {
+				entry.mat = ring.pool.back();
+				ring.pool.pop_back();
+			}
+		}
+		frame.mat().copyTo(entry.mat);
+		entry.bytes = entry.mat.total() * entry.mat.elemSize();
+	}
+
+	std::lock_guard<std::mutex> lock(ring.mtx);
+	if (!ring.entries.empty() && entry.timestamp < ring.entries.back().timestamp) {
+		// the source went back in time, e.g. a replay was rewound
+		ring.entries.clear();
+		ring.bytes = 0;
+	}
+	ring.entries.push_back(entry);
+	ring.bytes += entry.bytes;
+	evict(ring, entry.timestamp);
+
+	return true;
+}
+
+
+std::vector<std::vector<FrameType> > FrameHistory::snapshot(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end) const {
+	std::vector<std::vector<Entry> > entries = range(begin, end);
+	std::vector<std::vector<FrameType> > frames(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		frames[i].reserve(entries[i].size());
+		for (const auto& entry : entries[i]) {
+			frames[i].push_back(toFrame(entry));
+		}
+	}
+
+	return frames;
+}
+
+
+std::vector<std::vector<FrameType> > FrameHistory::last(double seconds) const {
+	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+	return snapshot(now - std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(seconds)), now);
+}
+
+
+bool FrameHistory::flush(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end, const std::string& directory) {
+	FlushJob job;
+	job.directory = directory;
+	job.entries = range(begin, end);
+
+	std::lock_guard<std::mutex> lock(mMtxFlush);
+	if (mStopFlush)
+		return false;
+	mFlushJobs.push_back(std::move(job));
+	mCvFlush.notify_all();
+
+	return true;
+}
+
+
+void FrameHistory::waitFlushes() {
+	std::unique_lock<std::mutex> lock(mMtxFlush);
+	mCvFlush.wait(lock, [this]() { return mFlushJobs.empty() && !mFlushing; });
+}
+
+
+void FrameHistory::clear() {
+	for (auto& ring : mRings) {
+		std::lock_guard<std::mutex> lock(ring->mtx);
+		ring->entries.clear();
+		ring->pool.clear();
+		ring->bytes = 0;
+	}
+}
+
+
+HistoryStats FrameHistory::stats() const {
+	HistoryStats stats;
+	for (const auto& ring : mRings) {
+		std::lock_guard<std::mutex> lock(ring->mtx);
+		stats.frames += ring->entries.size();
+		stats.bytes += ring->bytes;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mMtxStats);
+		stats.evicted = mEvicted;
+		stats.flushed = mFlushed;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mMtxFlush);
+		stats.flushesPending = mFlushJobs.size() + (mFlushing ? 1 : 0);
+	}
+
+	return stats;
+}
+
+
+// called with the lock of the ring held
+void FrameHistory::evict(Ring& ring, std::chrono::system_clock::time_point now) {
+	std::chrono::system_clock::time_point oldest = now - std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(mSettings.seconds));
+	unsigned long long evicted = 0;
+	while (ring.entries.size() > 1 && (ring.entries.front().timestamp < oldest || ring.bytes > mCameraBytes)) {
+		Entry& entry = ring.entries.front();
+		ring.bytes -= entry.bytes;
+
+		// a buffer still held by a snapshot or a flush is left to its holder
+		if (!entry.mat.empty() && entry.mat.u && entry.mat.u->refcount == 1 && ring.pool.size() < 4)
+			ring.pool.push_back(entry.mat);
+		ring.entries.pop_front();
+		evicted++;
+	}
+
+	if (evicted) {
+		std::lock_guard<std::mutex> lock(mMtxStats);
+		mEvicted += evicted;
+	}
+}
+
+
+std::vector<std::vector<FrameHistory::Entry> > FrameHistory::range(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end) const {
+	std::vector<std::vector<Entry> > entries(mRings.size());
+	for (size_t i = 0; i < mRings.size(); i++) {
+		const Ring& ring = *mRings[i];
+		std::lock_guard<std::mutex> lock(ring.mtx);
+		auto first = std::lower_bound(ring.entries.begin(), ring.entries.end(), begin,
+			[](const Entry& entry, std::chrono::system_clock::time_point t) { return entry.timestamp < t; });
+		auto last = std::upper_bound(first, ring.entries.end(), end,
+			[](std::chrono::system_clock::time_point t, const Entry& entry) { return t < entry.timestamp; });
+		entries[i].assign(first, last);	// the pixels are shared
+	}
+
+	return entries;
+}
+
+
+FrameType FrameHistory::toFrame(const Entry& entry) const {
+	FrameType frame;
+	if (entry.jpeg)
+		frame.mat() = cv::imdecode(*entry.jpeg, cv::IMREAD_UNCHANGED);
+	else
+		frame.mat() = entry.mat;
+	frame.setTimestamp(entry.timestamp);
+	frame.setPosition(entry.position);
+	frame.setBayer(entry.bayer);
+
+	return frame;
+}
+
+
+void FrameHistory::flushLoop() {
+	MVC_TRACE_THREAD_NAME("history flush");
+	std::unique_lock<std::mutex> lock(mMtxFlush);
+	while (true) {
+		mCvFlush.wait(lock, [this]() { return !mFlushJobs.empty() || mStopFlush; });
+		if (mFlushJobs.empty())
+			break;	// stopped, and everything queued is written
+
+		FlushJob job = std::move(mFlushJobs.front());
+		mFlushJobs.pop_front();
+		mFlushing = true;
+		lock.unlock();
+
+		write(job);
+
+		lock.lock();
+		mFlushing = false;
+		mCvFlush.notify_all();
+	}
+}
+
+
+void FrameHistory::write(const FlushJob& job) {
+	MVC_TRACE_SCOPE("history.flush");
+	const bool jpeg = mSettings.flushExtension == "jpg" || mSettings.flushExtension == "jpeg";
+	const bool lossy = jpeg || mSettings.flushExtension == "webp";
+	for (size_t i = 0; i < job.entries.size(); i++) {
+		if (job.entries[i].empty())
+			continue;
+
+		fs::path dir = fs::path(job.directory) / ("cam" + std::to_string(i));
+		boost::system::error_code ec;
+		fs::create_directories(dir, ec);
+
+		unsigned long long written = 0;
+		for (const auto& entry : job.entries[i]) {
+			long long msec = std::chrono::duration_cast<std::chrono::milliseconds>(entry.timestamp.time_since_epoch()).count();
+			// a mosaic is kept as is by the lossless formats only, and named after its pattern
+			bool mosaic = entry.bayer != BayerPattern::BAYER_NONE && !lossy;
+			std::string name = std::to_string(msec) + (mosaic ? std::string("_") + bayerName(entry.bayer) : std::string());
+			std::string filename = (dir / (name + "." + mSettings.flushExtension)).string();
+
+			bool status;
+			if (entry.jpeg && jpeg) {
+				// already encoded
+				std::ofstream file(filename, std::ios::binary);
+				file.write(reinterpret_cast<const char*>(entry.jpeg->data()), entry.jpeg->size());
+				status = file.good();
+			}
+			else {
+				FrameType frame = toFrame(entry);
+				status = cv::imwrite(filename, mosaic || !frame.isRaw() ? frame.mat() : frame.color());
+			}
+			if (status)
+				written++;
+		}
+
+		std::lock_guard<std::mutex> lock(mMtxStats);
+		mFlushed += written;
+	}
+}
@@ -0,0 +1,117 @@
+#ifndef FRAME_HISTORY_H_
+#define FRAME_HISTORY_H_
+
+
+#ifndef __cplusplus
+#  error FrameHistory.hpp header must be compiled as C++
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   How much of the past the FrameHistory keeps.
+ * @note    A camera keeps at most the last seconds, within its share of maxBytes.
+ */
+struct HistorySettings {
+	double seconds = 10.0;
+	size_t maxBytes = (size_t)512 * 1024 * 1024;	// all cameras together
+	bool compressed = false;	// keep JPEGs instead of the raw frames
+	int jpegQuality = 90;
+	std::string flushExtension = "jpg";	// image format of the flushed frames, lossy ones get the raw frames demosaiced
+};
+
+
+/**
+ * @brief   Counters of a FrameHistory, for all the cameras.
+ */
+struct HistoryStats {
+	size_t frames = 0;
+	size_t bytes = 0;
+	unsigned long long evicted = 0;
+	unsigned long long flushed = 0;	// frames written to disk
+	size_t flushesPending = 0;
+};
+
+
+/**
+ * @brief   Stage keeping the last seconds of every camera, for the frames before an incident.
+ * @note    process() copies the frame into a pooled buffer, duplicates flagged by the deduplication are
+ *          not kept. snapshot() finds a time range by binary search and returns frames sharing
+ *          the pixels of the history. flush() writes a range to disk on a background thread.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS FrameHistory : public FrameStage {
+public:
+	FrameHistory(size_t cameras, const HistorySettings& settings = HistorySettings());
+	virtual ~FrameHistory();	// waits for the pending flushes
+
+	virtual bool process(size_t camera, FrameType& frame);
+
+	// frames[camera] in time order, the compressed frames are decoded
+	virtual std::vector<std::vector<FrameType> > snapshot(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end) const;
+	virtual std::vector<std::vector<FrameType> > last(double seconds) const;
+
+	// <directory>/cam<N>/<msec since the epoch>.<extension>, returns once the range is queued
+	virtual bool flush(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end, const std::string& directory);
+	virtual void waitFlushes();
+
+	virtual void clear();
+	virtual HistoryStats stats() const;
+
+protected:
+	struct Entry {
+		std::chrono::system_clock::time_point timestamp;
+		double position;
+		BayerPattern bayer;
+		cv::Mat mat;	// empty when compressed
+		std::shared_ptr<std::vector<uchar> > jpeg;
+		size_t bytes;
+	};
+
+	struct Ring {
+		mutable std::mutex mtx;
+		std::deque<Entry> entries;	// in time order
+		size_t bytes;
+		std::vector<cv::Mat> pool;	// evicted buffers nobody else refers to
+	};
+
+	struct FlushJob {
+		std::string directory;
+		std::vector<std::vector<Entry> > entries;
+	};
+
+	virtual void evict(Ring& ring, std::chrono::system_clock::time_point now);
+	virtual std::vector<std::vector<Entry> > range(std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end) const;
+	virtual FrameType toFrame(const Entry& entry) const;
+	virtual void flushLoop();
+	virtual void write(const FlushJob& job);
+
+protected:
+	HistorySettings mSettings;
+	size_t mCameraBytes;	// share of maxBytes per camera
+	std::vector<std::unique_ptr<Ring> > mRings;
+
+	mutable std::mutex mMtxFlush;
+	std::condition_variable mCvFlush;
+	std::deque<FlushJob> mFlushJobs;
+	bool mFlushing;	// a job is being written
+	bool mStopFlush;
+	std::thread mFlushThread;
+
+	mutable std::mutex mMtxStats;
+	unsigned long long mEvicted;
+	unsigned long long mFlushed;
+};
+
+
+#endif // !FRAME_HISTORY_H_
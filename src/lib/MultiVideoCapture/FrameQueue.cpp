@@ -0,0 +1,123 @@
+#include "FrameQueue.hpp"
+
+
+FrameQueue::FrameQueue(size_t capacity) {
+	mCapacity = capacity > 0 ? capacity : 1;
+	mFinished = false;
+	mClosed = false;
+}
+
+
+FrameQueue::~FrameQueue() {
+	close();
+}
+
+
+bool FrameQueue::push(const FrameType& frame) {
+	std::unique_lock<std::mutex> lock(mMtxQueue);
+	mCvPush.wait(lock, [this]() { return mFrames.size() < mCapacity || mClosed; });
+	if (mClosed)
+		return false;
+
+	mFrames.push_back(frame);
+	lock.unlock();
+	mCvPop.notify_one();
+
+	return true;
+}
+
+
+bool FrameQueue::tryPush(const FrameType& frame) {
+	std::unique_lock<std::mutex> lock(mMtxQueue);
+	if (mClosed || mFrames.size() >= mCapacity)
+		return false;
+
+	mFrames.push_back(frame);
+	lock.unlock();
+	mCvPop.notify_one();
+
+	return true;
+}
+
+
+bool FrameQueue::pop(FrameType& frame) {
+	std::unique_lock<std::mutex> lock(mMtxQueue);
+	mCvPop.wait(lock, [this]() { return !mFrames.empty() || mFinished || mClosed; });
+	if (mClosed || mFrames.empty())
+		return false;
+
+	frame = mFrames.front();
+	mFrames.pop_front();
+	lock.unlock();
+	mCvPush.notify_one();
+
+	return true;
+}
+
+
+bool FrameQueue::peek(FrameType& frame) {
+	std::unique_lock<std::mutex> lock(mMtxQueue);
+	mCvPop.wait(lock, [this]() { return !mFrames.empty() || mFinished || mClosed; });
+	if (mClosed || mFrames.empty())
+		return false;
+
+	frame = mFrames.front();
+
+	return true;
+}
+
+
+void FrameQueue::finish() {
+	{
+		std::lock_guard<std::mutex> lock(mMtxQueue);
+		mFinished = true;
+	}
+	mCvPop.notify_all();
+}
+
+
+void FrameQueue::close() {
+	{
+		std::lock_guard<std::mutex> lock(mMtxQueue);
+		mClosed = true;
+	}
+	mCvPush.notify_all();
+	mCvPop.notify_all();
+}
+
+
+void FrameQueue::reset() {
+	{
+		std::lock_guard<std::mutex> lock(mMtxQueue);
+		mFrames.clear();
+		mFinished = false;
+		mClosed = false;
+	}
+	mCvPush.notify_all();
+}
+
+
+size_t FrameQueue::size() const {
+	std::lock_guard<std::mutex> lock(mMtxQueue);
+	return mFrames.size();
+}
+
+
+size_t FrameQueue::capacity() const {
+	return mCapacity;
+}
+
+
+void FrameQueue::setCapacity(size_t capacity) {
+	{
+		std::lock_guard<std::mutex> lock(mMtxQueue);
+		mCapacity = capacity > 0 ? capacity : 1;
+	}
+	mCvPush.notify_all();
+}
+
+
+bool FrameQueue::isFinished() const {
+	std::lock_guard<std::mutex> lock(mMtxQueue);
+	return mFinished && mFrames.empty();
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_QUEUE_H_
+#define FRAME_QUEUE_H_
+
+
+#ifndef __cplusplus
+#  error FrameQueue.hpp header must be compiled as C++
+#endif
+
+#ifndef MULTIVIDEOCAPTURE_EXPORTS
+#  ifdef DLL_EXPORTS
+#    if (defined _WIN32 || defined WINCE || defined __CYGWIN__)
+#      define MULTIVIDEOCAPTURE_EXPORTS __declspec(dllexport)
+#    elif defined __GNUC__ && __GNUC__ >= 4 || defined(__APPLE__)
+#      define MULTIVIDEOCAPTURE_EXPORTS __attribute__ ((visibility ("default")))
+#    endif
+#  else
+#    if (defined _WIN32 || defined WINCE || defined __CYGWIN__)
+#    define MULTIVIDEOCAPTURE_EXPORTS __declspec(dllimport)
+#    elif defined __GNUC__ && __GNUC__ >= 4 || defined(__APPLE__)
+#      define MULTIVIDEOCAPTURE_EXPORTS
+#    endif
+#  endif	// !DLL_EXPORTS
+#endif	// !MULTIVIDEOCAPTURE_EXPORTS
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "FrameType.hpp"
+
+
+/**
+ * @brief   Bounded blocking queue of frames between a producer (decoder) and a consumer.
+ * @note    finish() lets the consumer drain the remaining frames, close() aborts both sides.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS FrameQueue {
+public:
+	FrameQueue(size_t capacity = 8);
+	virtual ~FrameQueue();
+
+	virtual bool push(const FrameType& frame);	// blocks while the queue is full
+	virtual bool tryPush(const FrameType& frame);	// returns false instead of blocking
+	virtual bool pop(FrameType& frame);	// blocks while the queue is empty
+	virtual bool peek(FrameType& frame);	// same as pop() but keeps the frame in the queue
+
+	virtual void finish();
+	virtual void close();
+	virtual void reset();
+
+	virtual size_t size() const;
+	virtual size_t capacity() const;
+	virtual void setCapacity(size_t capacity);
+	virtual bool isFinished() const;
+
+protected:
+	std::deque<FrameType> mFrames;
+	size_t mCapacity;
+	bool mFinished;
+	bool mClosed;
+
+	mutable std::mutex mMtxQueue;
+	std::condition_variable mCvPush;
+	std::condition_variable mCvPop;
+};
+
+
+#endif // !FRAME_QUEUE_H_
@@ -0,0 +1,172 @@
+#include "FrameRateGovernor.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#endif
+
+
+FrameRateGovernor::FrameRateGovernor(size_t nbCams, const GovernorSettings& settings) {
+	mSettings = settings;
+	mWeights.assign(nbCams, 1.0);
+	mScales.assign(nbCams, 1.0);
+	mCredits.assign(nbCams, 1.0);
+	mSkipped.assign(nbCams, 0);
+	mBacklog.assign(nbCams, 0);
+	mLoad = 0.0;
+
+	mLastUpdate = std::chrono::steady_clock::now();
+	mReads = 0;
+	mLastIdle = 0;
+	mLastTotal = 0;
+	mCpuUsage = -1.0;
+	sampleCpu();	// the first sample only sets the reference
+}
+
+
+FrameRateGovernor::~FrameRateGovernor() {
+}
+
+
+void FrameRateGovernor::setSettings(const GovernorSettings& settings) {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	mSettings = settings;
+}
+
+
+void FrameRateGovernor::setWeight(size_t index, double weight) {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	if (index < mWeights.size() && weight > 0.0)
+		mWeights[index] = weight;
+}
+
+
+void FrameRateGovernor::reportBacklog(const std::vector<size_t>& depths) {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	for (size_t i = 0; i < depths.size() && i < mBacklog.size(); i++) {
+		mBacklog[i] = depths[i];
+	}
+}
+
+
+void FrameRateGovernor::onRead(double nominalFps) {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	mReads++;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed = now - mLastUpdate;
+	if (elapsed.count() * 1000.0 < mSettings.intervalMsec)
+		return;
+
+	update(nominalFps, elapsed.count());
+	mReads = 0;
+	mLastUpdate = now;
+}
+
+
+bool FrameRateGovernor::admit(size_t index) {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	if (index >= mScales.size())
+		return true;
+
+	mCredits[index] += mScales[index];
+	if (mCredits[index] >= 1.0) {
+		mCredits[index] -= 1.0;
+		return true;
+	}
+
+	mSkipped[index]++;
+	return false;
+}
+
+
+double FrameRateGovernor::scale(size_t index) const {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	return index < mScales.size() ? mScales[index] : 1.0;
+}
+
+
+unsigned long long FrameRateGovernor::skipped(size_t index) const {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	return index < mSkipped.size() ? mSkipped[index] : 0;
+}
+
+
+double FrameRateGovernor::load() const {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	return mLoad;
+}
+
+
+double FrameRateGovernor::cpuUsage() const {
+	std::lock_guard<std::mutex> lock(mMtxGovernor);
+	return mCpuUsage;
+}
+
+
+void FrameRateGovernor::update(double nominalFps, double elapsedSec) {
+	double drainFps = mReads / elapsedSec;
+	double cpu = sampleCpu();
+
+	bool behind = nominalFps > 0.0 && drainFps < nominalFps * mSettings.drainRatio;
+	bool backlog = false;
+	for (auto depth : mBacklog) {
+		backlog = backlog || depth >= mSettings.backlogHigh;
+	}
+	bool busy = cpu >= mSettings.cpuHigh;
+	bool idle = cpu < mSettings.cpuLow && !behind && !backlog;
+
+	// the load stops growing once the highest priority camera reaches the minimum rate.
+	double maxWeight = *std::max_element(mWeights.begin(), mWeights.end());
+	double maxLoad = maxWeight * (1.0 - mSettings.minScale);
+	if (busy || behind || backlog)
+		mLoad = std::min(mLoad + mSettings.step, maxLoad);
+	else if (idle)
+		mLoad = std::max(mLoad - mSettings.step, 0.0);
+
+	for (size_t i = 0; i < mScales.size(); i++) {
+		mScales[i] = std::max(mSettings.minScale, std::min(1.0, 1.0 - mLoad / mWeights[i]));
+	}
+}
+
+
+double FrameRateGovernor::sampleCpu() {
+	unsigned long long idle = 0, total = 0;
+
+#ifdef _WIN32
+	FILETIME idleTime, kernelTime, userTime;
+	if (!GetSystemTimes(&idleTime, &kernelTime, &userTime))
+		return mCpuUsage;
+
+	auto toUll = [](const FILETIME& t) { return ((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+	idle = toUll(idleTime);
+	total = toUll(kernelTime) + toUll(userTime);	// the kernel time includes the idle time
+#else
+	// "cpu user nice system idle iowait irq softirq steal ..."
+	std::ifstream ifs("/proc/stat");
+	std::string cpu;
+	if (!(ifs >> cpu) || cpu != "cpu")
+		return mCpuUsage;
+
+	unsigned long long value;
+	for (int i = 0; i < 8 && ifs >> value; i++) {
+		total += value;
+		if (i == 3 || i == 4)
+			idle += value;
+	}
+#endif
+
+	if (mLastTotal != 0 && total > mLastTotal) {
+		mCpuUsage = 1.0 - (double)(idle - mLastIdle) / (double)(total - mLastTotal);
+	}
+	mLastIdle = idle;
+	mLastTotal = total;
+
+	return mCpuUsage;
+}
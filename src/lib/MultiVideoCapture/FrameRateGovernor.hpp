@@ -0,0 +1,61 @@
+#ifndef FRAME_RATE_GOVERNOR_H_
+#define FRAME_RATE_GOVERNOR_H_
+
+
+#ifndef __cplusplus
+#  error FrameRateGovernor.hpp header must be compiled as C++
+#endif
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "GovernorSettings.hpp"
+
+
+/**
+ * @brief   Lowers the capture rate of each camera while the consumer can't keep up.
+ * @note    The load is shared out by the priority weights, a camera with weight w runs at
+ *          (1 - load / w) of its nominal rate. admit() spreads the skipped grabs evenly.
+ */
+class FrameRateGovernor {
+public:
+	FrameRateGovernor(size_t nbCams, const GovernorSettings& settings = GovernorSettings());
+	virtual ~FrameRateGovernor();
+
+	virtual void setSettings(const GovernorSettings& settings);
+	virtual void setWeight(size_t index, double weight);
+	virtual void reportBacklog(const std::vector<size_t>& depths);
+
+	virtual void onRead(double nominalFps);
+	virtual bool admit(size_t index);
+
+	virtual double scale(size_t index) const;
+	virtual unsigned long long skipped(size_t index) const;
+	virtual double load() const;
+	virtual double cpuUsage() const;
+
+protected:
+	virtual void update(double nominalFps, double elapsedSec);
+	virtual double sampleCpu();
+
+protected:
+	GovernorSettings mSettings;
+	std::vector<double> mWeights;
+	std::vector<double> mScales;
+	std::vector<double> mCredits;
+	std::vector<unsigned long long> mSkipped;
+	std::vector<size_t> mBacklog;
+	double mLoad;
+
+	std::chrono::steady_clock::time_point mLastUpdate;
+	unsigned long long mReads;
+	double mCpuUsage;
+	unsigned long long mLastIdle;
+	unsigned long long mLastTotal;
+
+	mutable std::mutex mMtxGovernor;
+};
+
+
+#endif // !FRAME_RATE_GOVERNOR_H_
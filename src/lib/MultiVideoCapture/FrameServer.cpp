@@ -0,0 +1,431 @@
+#include "FrameServer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+
+namespace {
+	const size_t PAGE_SIZE = 4096;
+
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+FrameServer::FrameServer(size_t cameras, size_t slots) {
+	mSlots = std::max<size_t>(2, slots);
+	mRings.resize(std::min(cameras, FrameWire::MAX_CAMERAS));
+	for (auto& ring : mRings) {
+		ring.fd = -1;
+		ring.data = NULL;
+		ring.bytes = 0;
+		ring.slotStride = 0;
+		ring.next = 0;
+		ring.generation = 0;
+		ring.fresh = false;
+	}
+	mListenFd = -1;
+	mRunning = false;
+	mSubscribed = 0;
+	mSequence = 0;
+	mRingsCreated = 0;
+	mVerbose = false;
+}
+
+
+FrameServer::~FrameServer() {
+	stop();
+	for (auto& ring : mRings) {
+		destroyRing(ring);
+	}
+}
+
+
+#ifdef __linux__
+
+bool FrameServer::start(const std::string& path) {
+	if (mRunning)
+		return false;
+
+	sockaddr_un addr;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path))
+		return false;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	mListenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (mListenFd < 0)
+		return false;
+
+	// a server which did not exit cleanly leaves its socket file behind
+	unlink(path.c_str());
+	if (bind(mListenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(mListenFd, 8) != 0) {
+		if (mVerbose)
+			std::cout << "cannot serve frames on " << path << ": " << std::strerror(errno) << std::endl;
+		close(mListenFd);
+		mListenFd = -1;
+		return false;
+	}
+
+	mPath = path;
+	mRunning = true;
+	mServeThread = std::thread(&FrameServer::serve, this);
+	if (mVerbose)
+		std::cout << "serving frames on " << path << std::endl;
+
+	return true;
+}
+
+
+void FrameServer::stop() {
+	if (!mRunning)
+		return;
+
+	mRunning = false;
+	if (mServeThread.joinable())
+		mServeThread.join();
+
+	std::lock_guard<std::mutex> lock(mMtxClients);
+	for (auto& client : mClients) {
+		close(client.fd);
+	}
+	mClients.clear();
+	mSubscribed = 0;
+
+	close(mListenFd);
+	mListenFd = -1;
+	unlink(mPath.c_str());
+}
+
+
+bool FrameServer::process(size_t camera, FrameType& frame) {
+	if (camera >= mRings.size() || !(mSubscribed.load(std::memory_order_relaxed) & (1ull << camera)))
+		return true;
+
+	const cv::Mat& mat = frame.mat();
+	if (mat.empty())
+		return true;
+
+	Ring& ring = mRings[camera];
+	size_t rowBytes = mat.cols * mat.elemSize();
+	size_t bytes = rowBytes * mat.rows;
+	if (ring.data == NULL || FrameWire::SLOT_HEADER_BYTES + bytes > ring.slotStride) {
+		if (!createRing(ring, bytes))
+			return true;
+	}
+
+	// seqlock, a client reading the slot meanwhile sees an odd or a newer sequence and drops its copy
+	uint8_t* slot = ring.data + ring.next * ring.slotStride;
+	FrameWire::SlotHeader* header = reinterpret_cast<FrameWire::SlotHeader*>(slot);
+	uint64_t sequence = header->sequence.load(std::memory_order_relaxed) + 1;
+	header->sequence.store(sequence, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	uint8_t* pixels = slot + FrameWire::SLOT_HEADER_BYTES;
+	if (mat.isContinuous()) {
+		std::memcpy(pixels, mat.data, bytes);
+	}
+	else {
+		for (int y = 0; y < mat.rows; y++) {
+			std::memcpy(pixels + y * rowBytes, mat.ptr(y), rowBytes);
+		}
+	}
+	header->sequence.store(sequence + 1, std::memory_order_release);
+
+	FrameWire::FrameHeader& info = ring.header;
+	info.camera = (uint32_t)camera;
+	info.slot = ring.next;
+	info.slotStride = ring.slotStride;
+	info.sequence = sequence + 1;
+	info.rows = mat.rows;
+	info.cols = mat.cols;
+	info.type = mat.type();
+	info.fd = -1;
+	info.step = rowBytes;
+	info.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.timestamp().time_since_epoch()).count();
+	info.position = frame.position();
+	info.bayer = (int32_t)frame.bayer();
+	ring.fresh = true;
+	ring.next = (ring.next + 1) % mSlots;
+
+	return true;
+}
+
+
+void FrameServer::endCycle() {
+	std::lock_guard<std::mutex> lock(mMtxClients);
+	mSequence++;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::vector<FrameWire::FrameHeader> headers;
+	std::vector<int> fds;
+	for (auto& client : mClients) {
+		if (client.dead || client.cameras == 0 || now < client.next)
+			continue;
+
+		headers.clear();
+		fds.clear();
+		for (size_t i = 0; i < mRings.size(); i++) {
+			const Ring& ring = mRings[i];
+			if (!ring.fresh || !(client.cameras & (1ull << i)))
+				continue;
+			headers.push_back(ring.header);
+			if (client.generations[i] != ring.generation) {
+				headers.back().fd = (int32_t)fds.size();
+				fds.push_back(ring.fd);
+			}
+		}
+		if (headers.empty())
+			continue;
+
+		FrameWire::FrameSetHeader set;
+		set.magic = FrameWire::MAGIC;
+		set.count = (uint32_t)headers.size();
+		set.sequence = mSequence;
+
+		iovec iov[2];
+		iov[0].iov_base = &set;
+		iov[0].iov_len = sizeof(set);
+		iov[1].iov_base = headers.data();
+		iov[1].iov_len = headers.size() * sizeof(FrameWire::FrameHeader);
+
+		msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+		std::vector<char> control(CMSG_SPACE(sizeof(int) * std::max<size_t>(1, fds.size())), 0);
+		if (!fds.empty()) {
+			msg.msg_control = control.data();
+			msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+			cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+			std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+		}
+
+		if (sendmsg(client.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) {
+			for (const auto& header : headers) {
+				client.generations[header.camera] = mRings[header.camera].generation;
+			}
+			mStats.setsSent++;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+			mStats.setsDropped++;
+		}
+		else {
+			// the serve thread closes the descriptor once it sees the hang up
+			client.dead = true;
+			shutdown(client.fd, SHUT_RDWR);
+			continue;
+		}
+
+		if (client.period > std::chrono::steady_clock::duration::zero()) {
+			client.next += client.period;
+			if (client.next < now)
+				client.next = now;
+		}
+	}
+
+	for (auto& ring : mRings) {
+		ring.fresh = false;
+	}
+}
+
+
+void FrameServer::serve() {
+	std::vector<pollfd> fds;
+	std::vector<int> clientFds;
+	while (mRunning) {
+		fds.clear();
+		clientFds.clear();
+		pollfd listenPoll = { mListenFd, POLLIN, 0 };
+		fds.push_back(listenPoll);
+		{
+			std::lock_guard<std::mutex> lock(mMtxClients);
+			for (const auto& client : mClients) {
+				pollfd clientPoll = { client.fd, POLLIN, 0 };
+				fds.push_back(clientPoll);
+				clientFds.push_back(client.fd);
+			}
+		}
+
+		if (poll(fds.data(), fds.size(), 100) <= 0)
+			continue;
+
+		if (fds[0].revents & POLLIN) {
+			int fd = accept4(mListenFd, NULL, NULL, SOCK_CLOEXEC);
+			if (fd >= 0) {
+				Client client;
+				client.fd = fd;
+				client.cameras = 0;
+				client.period = std::chrono::steady_clock::duration::zero();
+				client.next = std::chrono::steady_clock::now();
+				client.generations.assign(mRings.size(), 0);
+				client.dead = false;
+
+				std::lock_guard<std::mutex> lock(mMtxClients);
+				mClients.push_back(client);
+				if (mVerbose)
+					std::cout << "frame client " << fd << " connected" << std::endl;
+			}
+		}
+
+		for (size_t i = 1; i < fds.size(); i++) {
+			if (!fds[i].revents)
+				continue;
+
+			FrameWire::FrameSubscription subscription;
+			ssize_t size = (fds[i].revents & POLLIN) ? recv(fds[i].fd, &subscription, sizeof(subscription), MSG_DONTWAIT) : 0;
+			if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				continue;
+
+			std::lock_guard<std::mutex> lock(mMtxClients);
+			auto it = std::find_if(mClients.begin(), mClients.end(), [&](const Client& c) { return c.fd == clientFds[i - 1]; });
+			if (it == mClients.end())
+				continue;
+
+			if (size == (ssize_t)sizeof(subscription) && subscription.magic == FrameWire::MAGIC && !it->dead) {
+				uint64_t mask = mRings.size() < 64 ? (1ull << mRings.size()) - 1 : ~0ull;
+				it->cameras = subscription.cameras & mask;
+				it->period = std::chrono::steady_clock::duration::zero();
+				if (subscription.maxFps > 0.0)
+					it->period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / subscription.maxFps));
+				it->next = std::chrono::steady_clock::now();
+			}
+			else if (size <= 0 || it->dead) {
+				if (mVerbose)
+					std::cout << "frame client " << it->fd << " disconnected" << std::endl;
+				close(it->fd);
+				mClients.erase(it);
+			}
+			updateSubscriptions();
+		}
+	}
+}
+
+
+bool FrameServer::createRing(Ring& ring, size_t bytes) {
+	destroyRing(ring);
+
+	// some headroom, so a slightly bigger frame does not replace the ring
+	size_t stride = alignUp(FrameWire::SLOT_HEADER_BYTES + bytes + bytes / 8, PAGE_SIZE);
+	size_t total = stride * mSlots;
+
+	int fd = memfd_create("MultiVideoCapture", MFD_CLOEXEC);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, (off_t)total) != 0) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	// a new memfd is zero-filled, so every slot starts at sequence 0
+	ring.fd = fd;
+	ring.data = static_cast<uint8_t*>(data);
+	ring.bytes = total;
+	ring.slotStride = stride;
+	ring.next = 0;
+	ring.generation++;
+	mRingsCreated++;
+
+	return true;
+}
+
+
+void FrameServer::destroyRing(Ring& ring) {
+	// the clients keep their own mapping of the old ring
+	if (ring.data)
+		munmap(ring.data, ring.bytes);
+	if (ring.fd >= 0)
+		close(ring.fd);
+	ring.fd = -1;
+	ring.data = NULL;
+	ring.bytes = 0;
+	ring.slotStride = 0;
+}
+
+#else
+
+bool FrameServer::start(const std::string& path) {
+	if (mVerbose)
+		std::cout << "the frame server is not supported on this system" << std::endl;
+	return false;
+}
+
+
+void FrameServer::stop() {
+}
+
+
+bool FrameServer::process(size_t camera, FrameType& frame) {
+	return true;
+}
+
+
+void FrameServer::endCycle() {
+}
+
+
+void FrameServer::serve() {
+}
+
+
+bool FrameServer::createRing(Ring& ring, size_t bytes) {
+	return false;
+}
+
+
+void FrameServer::destroyRing(Ring& ring) {
+}
+
+#endif	// __linux__
+
+
+bool FrameServer::isRunning() const {
+	return mRunning;
+}
+
+
+FrameServerStats FrameServer::stats() const {
+	std::lock_guard<std::mutex> lock(mMtxClients);
+	FrameServerStats stats = mStats;
+	stats.clients = mClients.size();
+	stats.ringsCreated = mRingsCreated;
+
+	return stats;
+}
+
+
+void FrameServer::verbose(bool verbose) {
+	mVerbose = verbose;
+}
+
+
+// called with mMtxClients held
+void FrameServer::updateSubscriptions() {
+	uint64_t subscribed = 0;
+	for (const auto& client : mClients) {
+		if (!client.dead)
+			subscribed |= client.cameras;
+	}
+	mSubscribed = subscribed;
+}
@@ -0,0 +1,147 @@
+#ifndef FRAME_SERVER_H_
+#define FRAME_SERVER_H_
+
+
+#ifndef __cplusplus
+#  error FrameServer.hpp header must be compiled as C++
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   Messages between the FrameServer and its clients, over a SOCK_SEQPACKET Unix socket.
+ * @note    A client sends a FrameSubscription whenever it wants to change what it gets.
+ *          The server sends one message per frame set: a FrameSetHeader, then a FrameHeader per camera.
+ *          The pixels stay in a shared memory ring per camera; its file descriptor is attached
+ *          to the first header a client gets from it.
+ */
+namespace FrameWire {
+	const uint32_t MAGIC = 0x3143564d;	// "MVC1"
+	const size_t MAX_CAMERAS = 64;	// bits of the subscription mask
+	const size_t SLOT_HEADER_BYTES = 64;	// the pixels of a slot follow its SlotHeader
+
+	struct FrameSubscription {
+		uint32_t magic;
+		uint32_t reserved;
+		uint64_t cameras;	// bit i for camera i
+		double maxFps;	// 0 for every frame set
+	};
+
+	struct FrameSetHeader {
+		uint32_t magic;
+		uint32_t count;	// FrameHeaders following
+		uint64_t sequence;	// of the set, gaps are sets the client missed
+	};
+
+	struct FrameHeader {
+		uint32_t camera;
+		uint32_t slot;
+		uint64_t slotStride;	// [bytes] from a slot to the next one, header included
+		uint64_t sequence;	// of the slot when the frame was written
+		int32_t rows;
+		int32_t cols;
+		int32_t type;
+		int32_t fd;	// index among the attached descriptors, -1 when the client has the ring already
+		uint64_t step;
+		int64_t timestampNs;	// since the system clock epoch
+		double position;
+		int32_t bayer;	// BayerPattern of a raw frame
+	};
+
+	// seqlock of a slot in the shared memory, odd while the server writes the slot
+	struct SlotHeader {
+		std::atomic<uint64_t> sequence;
+	};
+}
+
+
+/**
+ * @brief   Counters of a FrameServer.
+ */
+struct FrameServerStats {
+	size_t clients = 0;
+	unsigned long long setsSent = 0;
+	unsigned long long setsDropped = 0;	// a client socket was full
+	unsigned long long ringsCreated = 0;
+};
+
+
+/**
+ * @brief   Stage serving the frame sets of its MultiVideoCapture to other processes of the machine.
+ * @note    Each camera is copied once into a shared memory ring (memfd), only the headers and the
+ *          timestamps go through the socket. Clients subscribe to a subset of the cameras and
+ *          may ask for fewer sets per second. A slow client misses sets, the capture never waits.
+ *          Linux only, start() returns false on other systems.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS FrameServer : public FrameStage {
+public:
+	FrameServer(size_t cameras, size_t slots = 4);
+	virtual ~FrameServer();
+
+	virtual bool start(const std::string& path);
+	virtual void stop();
+	virtual bool isRunning() const;
+
+	virtual bool process(size_t camera, FrameType& frame);
+	virtual void endCycle();
+
+	virtual FrameServerStats stats() const;
+	virtual void verbose(bool verbose = false);
+
+protected:
+	struct Ring {
+		int fd;
+		uint8_t* data;
+		size_t bytes;
+		size_t slotStride;
+		uint32_t next;
+		uint32_t generation;
+		bool fresh;	// written in the current cycle
+		FrameWire::FrameHeader header;
+	};
+
+	struct Client {
+		int fd;
+		uint64_t cameras;
+		std::chrono::steady_clock::duration period;
+		std::chrono::steady_clock::time_point next;
+		std::vector<uint32_t> generations;	// of the rings the client has, 0 for none
+		bool dead;
+	};
+
+	virtual void serve();	// accepts the clients and reads their subscriptions
+	virtual bool createRing(Ring& ring, size_t bytes);
+	virtual void destroyRing(Ring& ring);
+	virtual void updateSubscriptions();
+
+protected:
+	size_t mSlots;
+	std::vector<Ring> mRings;
+
+	std::string mPath;
+	int mListenFd;
+	std::atomic<bool> mRunning;
+	std::thread mServeThread;
+
+	mutable std::mutex mMtxClients;
+	std::list<Client> mClients;
+	std::atomic<uint64_t> mSubscribed;	// cameras at least one client wants
+
+	uint64_t mSequence;
+	FrameServerStats mStats;
+	std::atomic<unsigned long long> mRingsCreated;
+	bool mVerbose;
+};
+
+
+#endif // !FRAME_SERVER_H_
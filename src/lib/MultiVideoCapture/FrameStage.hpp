@@ -0,0 +1,44 @@
+#ifndef FRAME_STAGE_H_
+#define FRAME_STAGE_H_
+
+
+#ifndef __cplusplus
+#  error FrameStage.hpp header must be compiled as C++
+#endif
+
+#ifndef MULTIVIDEOCAPTURE_EXPORTS
+#  ifdef DLL_EXPORTS
+#    if (defined _WIN32 || defined WINCE || defined __CYGWIN__)
+#      define MULTIVIDEOCAPTURE_EXPORTS __declspec(dllexport)
+#    elif defined __GNUC__ && __GNUC__ >= 4 || defined(__APPLE__)
+#      define MULTIVIDEOCAPTURE_EXPORTS __attribute__ ((visibility ("default")))
+#    endif
+#  else
+#    if (defined _WIN32 || defined WINCE || defined __CYGWIN__)
+#    define MULTIVIDEOCAPTURE_EXPORTS __declspec(dllimport)
+#    elif defined __GNUC__ && __GNUC__ >= 4 || defined(__APPLE__)
+#      define MULTIVIDEOCAPTURE_EXPORTS
+#    endif
+#  endif	// !DLL_EXPORTS
+#endif	// !MULTIVIDEOCAPTURE_EXPORTS
+
+#include <cstddef>
+
+#include "FrameType.hpp"
+
+
+/**
+ * @brief   Processing step run on the capture thread of a camera, right after its frame is retrieved.
+ * @note    process() runs concurrently for different cameras, never twice at once for the same one.
+ *          endCycle() runs on the consumer thread once every camera of a read() is done.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS FrameStage {
+public:
+	virtual ~FrameStage() {}
+
+	virtual bool process(size_t camera, FrameType& frame) = 0;	// false drops the frame from the delivery
+	virtual void endCycle() {}
+};
+
+
+#endif // !FRAME_STAGE_H_
@@ -1,81 +1,101 @@
 #include "FrameType.hpp"
+#include "Demosaic.hpp"
 
 
-inline
 FrameType::FrameType() {
 	release();
 }
 
 
-inline
 FrameType::~FrameType() {
 	release();
 }
 
 
-inline
 FrameType FrameType::clone() const {
 	FrameType obj;
 	obj.mFrame = this->mFrame.clone();
 	obj.mTimestamp = this->mTimestamp;
+	obj.mPosition = this->mPosition;
+	obj.mDuplicate = this->mDuplicate;
+	obj.mChanged = this->mChanged;
+	obj.mBayer = this->mBayer;
 
 	return obj;
 }
 
 
-inline
 void FrameType::copyTo(FrameType& obj) {
 	this->mFrame.copyTo(obj.mFrame);
 	obj.mTimestamp = this->mTimestamp;
+	obj.mPosition = this->mPosition;
+	obj.mDuplicate = this->mDuplicate;
+	obj.mChanged = this->mChanged;
+	obj.setBayer(this->mBayer);
 }
 
 
-inline
-bool FrameType::empty() const {
-	return mFrame.empty();
-}
-
-
-inline
 bool FrameType::setFrame(const cv::Mat& frame) {
 	return setFrame(frame, std::chrono::system_clock::now());
 }
 
 
-inline
 bool FrameType::setFrame(const cv::Mat& frame, std::chrono::system_clock::time_point timestamp) {
 	mFrame = frame.clone();
 	mTimestamp = timestamp;
+	mColorValid = false;
 	return true;
 }
 
 
-inline
-void FrameType::setTimestamp(std::chrono::system_clock::time_point timestamp) {
-	mTimestamp = timestamp;
+cv::Mat FrameType::color(DemosaicMode mode) {
+	if (mFrame.empty())
+		return cv::Mat();
+	if (mColorValid && mColorMode == mode)
+		return mColor;
+	if (mode == DemosaicMode::DEMOSAIC_FULL && !isRaw())
+		return mFrame;
+
+	// a buffer still held by the caller is left to it
+	if (mColor.u && mColor.u->refcount > 1)
+		mColor.release();
+
+	bool status = true;
+	if (isRaw()) {
+		status = demosaic(mFrame, mBayer, mode, mColor);
+	}
+	else if (mode == DemosaicMode::DEMOSAIC_HALF) {
+		cv::resize(mFrame, mColor, cv::Size(mFrame.cols / 2, mFrame.rows / 2), 0, 0, cv::INTER_AREA);
+	}
+	else if (mFrame.channels() == 1) {
+		return mFrame;
+	}
+	else {
+		cv::cvtColor(mFrame, mColor, mFrame.channels() == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+	}
+	if (!status)
+		return mFrame;	// not a mosaic OpenCV can convert
+
+	mColorMode = mode;
+	mColorValid = true;
+
+	return mColor;
 }
 
 
-inline
 cv::Mat FrameType::frame() const {
 	return mFrame.clone();
 }
 
 
-inline
-cv::Mat& FrameType::mat() {
-	return mFrame;
-}
-
-
-inline
-std::chrono::system_clock::time_point FrameType::timestamp() const {
-	return mTimestamp;
-}
-
-
-inline
 void FrameType::release() {
 	mFrame.release();
 	mTimestamp = std::chrono::system_clock::time_point();
+	mPosition = -1.0;
+	mDuplicate = false;
+	mChanged = true;
+	mBayer = BayerPattern::BAYER_NONE;
+	mColor.release();
+	mColorMode = DemosaicMode::DEMOSAIC_FULL;
+	mColorValid = false;
 }
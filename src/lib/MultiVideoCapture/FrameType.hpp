@@ -28,6 +28,7 @@
 
 #include <chrono>
 #include "opencv2/opencv.hpp"
+#include "BayerPattern.hpp"
 
 
 FRAMETYPE_TEMPLATE template class FRAMETYPE_EXPORTS std::chrono::duration<std::chrono::system_clock::rep, std::chrono::system_clock::period>;
@@ -46,16 +47,111 @@ public:
 	virtual bool setFrame(const cv::Mat& frame);
 	virtual bool setFrame(const cv::Mat& frame, std::chrono::system_clock::time_point timestamp);
 	virtual void setTimestamp(std::chrono::system_clock::time_point timestamp);
+	virtual void setPosition(double msec);
+	virtual void setDuplicate(bool duplicate);
+	virtual void setChanged(bool changed);
+	virtual void setBayer(BayerPattern pattern);	// the pixels are a raw mosaic of this pattern
+	virtual void setMat(const cv::Mat& frame);	// replaces the pixels without a copy, keeps the rest
 	virtual cv::Mat frame() const;
-	virtual cv::Mat& mat();
+	virtual cv::Mat& mat();	// in place only, assigning other pixels leaves color() stale
 	virtual std::chrono::system_clock::time_point timestamp() const;
+	virtual double position() const;	// position in the source stream [msec]. -1 for live cameras.
+	virtual bool isDuplicate() const;	// the camera delivered this frame before
+	virtual bool isChanged() const;	// false when a change detector saw nothing happen since the last frames
+	virtual BayerPattern bayer() const;
+	virtual bool isRaw() const;
+
+	// the pixels in the format of the mode, demosaiced on the first call and cached on the frame.
+	// frame() and mat() stay the raw mosaic. Not thread-safe on the same frame.
+	virtual cv::Mat color(DemosaicMode mode = DemosaicMode::DEMOSAIC_FULL);
 
 	virtual void release();
 
 protected:
 	cv::Mat mFrame;
 	std::chrono::system_clock::time_point mTimestamp;
+	double mPosition;
+	bool mDuplicate;
+	bool mChanged;
+	BayerPattern mBayer;
+
+	cv::Mat mColor;	// converted pixels, reused by the next frames
+	DemosaicMode mColorMode;
+	bool mColorValid;	// mColor is the current pixels in mColorMode
 };
 
 
+// the accessors on the per-frame path are defined here, so a qualified call inlines.
+inline bool FrameType::empty() const {
+	return mFrame.empty();
+}
+
+
+inline void FrameType::setTimestamp(std::chrono::system_clock::time_point timestamp) {
+	mTimestamp = timestamp;
+}
+
+
+inline void FrameType::setPosition(double msec) {
+	mPosition = msec;
+}
+
+
+inline void FrameType::setDuplicate(bool duplicate) {
+	mDuplicate = duplicate;
+}
+
+
+inline void FrameType::setChanged(bool changed) {
+	mChanged = changed;
+}
+
+
+inline void FrameType::setBayer(BayerPattern pattern) {
+	mBayer = pattern;
+	mColorValid = false;
+}
+
+
+inline void FrameType::setMat(const cv::Mat& frame) {
+	mFrame = frame;
+	mColorValid = false;
+}
+
+
+inline cv::Mat& FrameType::mat() {
+	return mFrame;
+}
+
+
+inline std::chrono::system_clock::time_point FrameType::timestamp() const {
+	return mTimestamp;
+}
+
+
+inline double FrameType::position() const {
+	return mPosition;
+}
+
+
+inline bool FrameType::isDuplicate() const {
+	return mDuplicate;
+}
+
+
+inline bool FrameType::isChanged() const {
+	return mChanged;
+}
+
+
+inline BayerPattern FrameType::bayer() const {
+	return mBayer;
+}
+
+
+inline bool FrameType::isRaw() const {
+	return mBayer != BayerPattern::BAYER_NONE;
+}
+
+
 #endif // !FRAME_TYPE_H_
@@ -0,0 +1,28 @@
+#ifndef GOVERNOR_SETTINGS_H_
+#define GOVERNOR_SETTINGS_H_
+
+
+#ifndef __cplusplus
+#  error GovernorSettings.hpp header must be compiled as C++
+#endif
+
+#include <cstddef>
+
+
+/**
+ * @brief   Thresholds of the frame-rate governor.
+ * @note    The load goes up while the consumer drains slower than the cameras capture,
+ *          a reported backlog is deep or the CPU is busy, and goes down once they are all idle.
+ */
+struct GovernorSettings {
+	double cpuHigh = 0.85;	// CPU usage throttling the capture [0, 1]
+	double cpuLow = 0.60;	// CPU usage ramping the capture back up [0, 1]
+	double drainRatio = 0.9;	// consumer is behind below this fraction of the capture fps
+	size_t backlogHigh = 4;	// frames waiting in a consumer queue considered as backlog
+	double minScale = 0.1;	// lowest fraction of the nominal rate of a camera
+	double step = 0.1;	// load change per update
+	int intervalMsec = 500;	// time between updates
+};
+
+
+#endif // !GOVERNOR_SETTINGS_H_
@@ -0,0 +1,106 @@
+#include "LazyFrameSet.hpp"
+
+
+LazyFrameSet::LazyFrameSet() {
+	mCapture = NULL;
+	mFlag = 0;
+}
+
+
+LazyFrameSet::~LazyFrameSet() {
+	release();
+}
+
+
+size_t LazyFrameSet::size() const {
+	return mFrames.size();
+}
+
+
+bool LazyFrameSet::isGrabbed(size_t camera) const {
+	return camera < mGrabbed.size() && mGrabbed[camera];
+}
+
+
+bool LazyFrameSet::isDecoded(size_t camera) const {
+	return camera < mDecoded.size() && mDecoded[camera];
+}
+
+
+FrameType& LazyFrameSet::at(size_t camera) {
+	fetch(std::vector<size_t>(1, camera));
+	return mFrames.at(camera);
+}
+
+
+FrameType& LazyFrameSet::operator [] (size_t camera) {
+	return at(camera);
+}
+
+
+bool LazyFrameSet::fetch(const std::vector<size_t>& cameras) {
+	if (mCapture == NULL)
+		return false;
+
+	std::vector<size_t> pending;
+	for (size_t camera : cameras) {
+		if (camera < mFrames.size() && mGrabbed[camera] && !mDecoded[camera]) {
+			pending.push_back(camera);
+			mDecoded[camera] = 1;
+		}
+	}
+	if (pending.empty())
+		return true;
+
+	mStats.decoded += pending.size();
+	return mCapture->retrieveCameras(mFrames, pending, mFlag);
+}
+
+
+bool LazyFrameSet::fetchAll() {
+	std::vector<size_t> cameras(mFrames.size());
+	for (size_t i = 0; i < cameras.size(); i++) {
+		cameras[i] = i;
+	}
+
+	return fetch(cameras);
+}
+
+
+void LazyFrameSet::release() {
+	if (mCapture == NULL)
+		return;
+
+	bool decoded = false;
+	for (size_t i = 0; i < mFrames.size(); i++) {
+		if (mGrabbed[i] && !mDecoded[i])
+			mStats.skipped++;
+		decoded = decoded || mDecoded[i];
+	}
+	if (decoded)
+		mCapture->endStageCycle();
+	mCapture = NULL;
+}
+
+
+LazyStats LazyFrameSet::stats() const {
+	return mStats;
+}
+
+
+void LazyFrameSet::latch(MultiVideoCapture* capture, const std::vector<char>& grabbed, int flag) {
+	release();
+
+	// the frames keep their buffers for the next retrieves
+	mCapture = capture;
+	mFlag = flag;
+	mFrames.resize(grabbed.size());
+	mGrabbed = grabbed;
+	mDecoded.assign(grabbed.size(), 0);
+	for (size_t i = 0; i < mFrames.size(); i++) {
+		if (mGrabbed[i])
+			mStats.grabbed++;
+		else
+			mFrames[i].release();
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef LAZY_FRAME_SET_H_
+#define LAZY_FRAME_SET_H_
+
+
+#ifndef __cplusplus
+#  error LazyFrameSet.hpp header must be compiled as C++
+#endif
+
+#include <vector>
+
+#include "FrameType.hpp"
+#include "MultiVideoCapture.hpp"
+
+
+/**
+ * @brief   Counters of a LazyFrameSet since it was created.
+ */
+struct LazyStats {
+	unsigned long long grabbed = 0;
+	unsigned long long decoded = 0;
+	unsigned long long skipped = 0;	// grabbed and never decoded
+};
+
+
+/**
+ * @brief   Frames of one MultiVideoCapture::grab(LazyFrameSet&), retrieved on first access.
+ * @note    Only the cameras the consumer touches are retrieved and go through the stages, fetch()
+ *          retrieves several in parallel. The other grabs are dropped by the next grab.
+ *          The stages end their cycle when the set is released, by the next grab at the latest.
+ *          Release the set before its MultiVideoCapture.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS LazyFrameSet {
+public:
+	LazyFrameSet();
+	virtual ~LazyFrameSet();
+
+	virtual size_t size() const;
+	virtual bool isGrabbed(size_t camera) const;
+	virtual bool isDecoded(size_t camera) const;
+
+	virtual FrameType& at(size_t camera);	// retrieved on first access, empty when the camera was not grabbed
+	virtual FrameType& operator [] (size_t camera);
+	virtual bool fetch(const std::vector<size_t>& cameras);	// retrieves the ones not done yet, in parallel
+	virtual bool fetchAll();
+
+	virtual void release();
+	virtual LazyStats stats() const;
+
+protected:
+	friend class MultiVideoCapture;
+
+	virtual void latch(MultiVideoCapture* capture, const std::vector<char>& grabbed, int flag);
+
+protected:
+	MultiVideoCapture* mCapture;	// NULL once released
+	std::vector<FrameType> mFrames;
+	std::vector<char> mGrabbed;
+	std::vector<char> mDecoded;
+	int mFlag;
+	LazyStats mStats;
+};
+
+
+#endif // !LAZY_FRAME_SET_H_
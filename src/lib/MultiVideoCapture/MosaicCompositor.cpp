@@ -0,0 +1,116 @@
+#include "MosaicCompositor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+MosaicCompositor::MosaicCompositor(size_t cameras, const MosaicLayout& layout) {
+	mCameras = cameras;
+	setLayout(layout);
+}
+
+
+MosaicCompositor::~MosaicCompositor() {
+}
+
+
+bool MosaicCompositor::process(size_t camera, FrameType& frame) {
+	if (camera >= mCameras || !frame.isChanged())
+		return true;	// an unchanged frame keeps the previous tile
+
+	// a raw frame shrunk to less than half its size only needs the binned demosaic
+	cv::Rect inner = fitRect(frame.mat().size());
+	DemosaicMode mode = frame.isRaw() && inner.width * 2 <= frame.mat().cols ? DemosaicMode::DEMOSAIC_HALF : DemosaicMode::DEMOSAIC_FULL;
+	cv::Mat src = frame.color(mode);
+	cv::Mat tile = mCanvas[mBack](tileRect(camera));
+
+	// the letterbox bars only change with the frame size
+	if (inner.size() != tile.size() && mFilled[mBack][camera] != src.size()) {
+		tile.setTo(mLayout.borderColor);
+		mFilled[mBack][camera] = src.size();
+	}
+
+	// the destinations are views of the canvas, so resize and cvtColor write in place.
+	cv::Mat dst = tile(inner);
+	if (src.type() == CV_8UC3) {
+		cv::resize(src, dst, inner.size(), 0, 0, mLayout.interpolation);
+	}
+	else if (src.type() == CV_8UC1 || src.type() == CV_8UC4) {
+		cv::resize(src, mScaled[camera], inner.size(), 0, 0, mLayout.interpolation);
+		cv::cvtColor(mScaled[camera], dst, src.channels() == 1 ? cv::COLOR_GRAY2BGR : cv::COLOR_BGRA2BGR);
+	}
+	else {
+		return true;	// not shown
+	}
+	mWritten[camera] = 1;
+
+	return true;
+}
+
+
+void MosaicCompositor::endCycle() {
+	int front = mBack ^ 1;
+	for (size_t i = 0; i < mCameras; i++) {
+		if (!mWritten[i]) {
+			cv::Rect rect = tileRect(i);
+			cv::Mat tile = mCanvas[mBack](rect);
+			mCanvas[front](rect).copyTo(tile);
+			mFilled[mBack][i] = mFilled[front][i];
+		}
+		mWritten[i] = 0;
+	}
+	mBack = front;
+}
+
+
+cv::Mat MosaicCompositor::mosaic() const {
+	return mCanvas[mBack ^ 1];
+}
+
+
+cv::Rect MosaicCompositor::tileRect(size_t camera) const {
+	int col = (int)camera % mColumns;
+	int row = (int)camera / mColumns;
+	int border = mLayout.border;
+
+	return cv::Rect(border + col * (mLayout.tileSize.width + border), border + row * (mLayout.tileSize.height + border), mLayout.tileSize.width, mLayout.tileSize.height);
+}
+
+
+void MosaicCompositor::setLayout(const MosaicLayout& layout) {
+	mLayout = layout;
+	mLayout.border = std::max(0, mLayout.border);
+	mColumns = mLayout.columns > 0 ? mLayout.columns : std::max(1, (int)std::ceil(std::sqrt((double)mCameras)));
+	mRows = std::max(1, ((int)mCameras + mColumns - 1) / mColumns);
+
+	cv::Size canvasSize(
+		mColumns * mLayout.tileSize.width + (mColumns + 1) * mLayout.border,
+		mRows * mLayout.tileSize.height + (mRows + 1) * mLayout.border);
+	for (int i = 0; i < 2; i++) {
+		mCanvas[i].create(canvasSize, CV_8UC3);
+		mCanvas[i].setTo(mLayout.borderColor);
+		mFilled[i].assign(mCameras, cv::Size());
+	}
+	mBack = 0;
+	mWritten.assign(mCameras, 0);
+	mScaled.resize(mCameras);
+}
+
+
+MosaicLayout MosaicCompositor::layout() const {
+	return mLayout;
+}
+
+
+cv::Rect MosaicCompositor::fitRect(cv::Size frameSize) const {
+	cv::Size tile = mLayout.tileSize;
+	if (!mLayout.keepAspect || frameSize.width <= 0 || frameSize.height <= 0)
+		return cv::Rect(cv::Point(0, 0), tile);
+
+	double scale = std::min((double)tile.width / frameSize.width, (double)tile.height / frameSize.height);
+	cv::Size size(std::max(1, (int)std::lround(frameSize.width * scale)), std::max(1, (int)std::lround(frameSize.height * scale)));
+	size.width = std::min(size.width, tile.width);
+	size.height = std::min(size.height, tile.height);
+
+	return cv::Rect((tile.width - size.width) / 2, (tile.height - size.height) / 2, size.width, size.height);
+}
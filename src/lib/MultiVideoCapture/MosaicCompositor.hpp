@@ -0,0 +1,65 @@
+#ifndef MOSAIC_COMPOSITOR_H_
+#define MOSAIC_COMPOSITOR_H_
+
+
+#ifndef __cplusplus
+#  error MosaicCompositor.hpp header must be compiled as C++
+#endif
+
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   Grid of the mosaic, every camera is scaled into a tile of the same size.
+ */
+struct MosaicLayout {
+	int columns = 0;	// 0 for a square grid
+	cv::Size tileSize = { 320, 240 };
+	int border = 2;	// [px] between and around the tiles
+	cv::Scalar borderColor = cv::Scalar(0, 0, 0);
+	bool keepAspect = true;	// letterbox the frames instead of stretching them
+	int interpolation = cv::INTER_AREA;
+};
+
+
+/**
+ * @brief   Stage tiling all the cameras into one BGR image.
+ * @note    Every capture thread scales its frame straight into its tile of the back canvas,
+ *          in a single pass. endCycle() swaps the canvases, a camera without a frame in the cycle
+ *          keeps its previous tile. The frames themselves are delivered unchanged.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS MosaicCompositor : public FrameStage {
+public:
+	MosaicCompositor(size_t cameras, const MosaicLayout& layout = MosaicLayout());
+	virtual ~MosaicCompositor();
+
+	virtual bool process(size_t camera, FrameType& frame);
+	virtual void endCycle();
+
+	virtual cv::Mat mosaic() const;	// shared with the compositor, valid until the next read()
+	virtual cv::Rect tileRect(size_t camera) const;
+
+	virtual void setLayout(const MosaicLayout& layout);	// only between two reads
+	virtual MosaicLayout layout() const;
+
+protected:
+	virtual cv::Rect fitRect(cv::Size frameSize) const;	// inside the tile
+
+protected:
+	MosaicLayout mLayout;
+	size_t mCameras;
+	int mColumns;
+	int mRows;
+
+	cv::Mat mCanvas[2];
+	int mBack;	// canvas written by the capture threads
+	std::vector<char> mWritten;	// per camera, in the current cycle
+	std::vector<cv::Size> mFilled[2];	// frame size each tile was letterboxed for
+	std::vector<cv::Mat> mScaled;	// per camera, for the frames which are not BGR
+};
+
+
+#endif // !MOSAIC_COMPOSITOR_H_
@@ -1,15 +1,136 @@
 #include "MultiVideoCapture.hpp"
 #include "VideoCaptureType.hpp"
+#include "LazyFrameSet.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <memory>
 std::atomic_bool gKeepCamOpening;
+std::atomic_bool gOpenPassDone;	// every camera has been tried once
 std::atomic_bool gCamSetChanged;	//TODO adding the function for online camera settings change.
 
+#include "Trace.hpp"
+
 #include "ThreadPool.hpp"
 ThreadPool::ThreadPool* pThread_pool = NULL;
 
+#include "PlaybackEngine.hpp"
+PlaybackEngine* gPlayback = NULL;	// decode-ahead engine for the video files
+
+#include "FrameRateGovernor.hpp"
+FrameRateGovernor* gGovernor = NULL;	// throttles the cameras when the consumer falls behind
+
+#include "DeviceCapsCache.hpp"
+DeviceCapsCache* gCapsCache = NULL;	// known capture modes of the devices
+
+#include "FrameArena.hpp"
+FrameArena* gArena = NULL;	// huge-page backed pixel buffers of the frames
+
+#include "DeadlineScheduler.hpp"
+DeadlineScheduler* gScheduler = NULL;	// reads every camera at its own rate
+
+
+#include "CameraSlot.hpp"
+CameraSlots gSlots;	// to hide from the MultiVideoCapture class
+
+#include <mutex>
+std::mutex gMtxAsync;
+std::vector<char> gAsyncBusy;	// per camera, an async read is running
+
+
+namespace {
+	// marks the cameras as read by an async read, none when one of them is already.
+	bool claimAsync(const std::vector<size_t>& cameras, size_t nbDevs) {
+		std::lock_guard<std::mutex> lock(gMtxAsync);
+		if (gAsyncBusy.size() < nbDevs)
+			gAsyncBusy.resize(nbDevs, 0);
+		for (size_t i : cameras) {
+			if (gAsyncBusy[i])
+				return false;
+		}
+		for (size_t i : cameras) {
+			gAsyncBusy[i] = 1;
+		}
+		return true;
+	}
+
 
-std::vector<VideoCaptureType*> gVidCaps;	// to hide from the MultiVideoCapture class
+	void releaseAsync(const std::vector<size_t>& cameras) {
+		std::lock_guard<std::mutex> lock(gMtxAsync);
+		for (size_t i : cameras) {
+			gAsyncBusy[i] = 0;
+		}
+	}
+
+
+	// every camera held by a sync call for its duration, which fails while an async read runs.
+	class SyncClaim {
+	public:
+		SyncClaim(size_t nbDevs) : mCameras(nbDevs) {
+			for (size_t i = 0; i < nbDevs; i++) {
+				mCameras[i] = i;
+			}
+			mHeld = claimAsync(mCameras, nbDevs);
+		}
+
+		~SyncClaim() {
+			release();
+		}
+
+		bool held() const {
+			return mHeld;
+		}
+
+		void release() {
+			if (mHeld)
+				releaseAsync(mCameras);
+			mHeld = false;
+		}
+
+	private:
+		std::vector<size_t> mCameras;
+		bool mHeld;
+	};
+
+
+	// shared by the capture jobs of an async read, the last one completes it.
+	struct AsyncRead {
+		std::atomic<int> remaining;
+		std::atomic<bool> status;
+		std::atomic<bool> failed;	// a job threw
+		std::vector<size_t> cameras;
+		CaptureCallback done;
+	};
+}
+
+
+// runs the stages on the frame of a camera, the frame is released when one of them drops it.
+bool processStages(const std::vector<FrameStage*>& stages, size_t index, FrameType& frame) {
+	for (auto stage : stages) {
+		if (frame.empty())
+			break;
+		if (!stage->process(index, frame)) {
+			frame.release();
+			break;
+		}
+	}
+
+	return !frame.empty();
+}
+
+
+bool readStaged(VideoCaptureType* vc, FrameType& frame, size_t index, const std::vector<FrameStage*>& stages) {
+	bool res = vc->read(frame);
+
+	return processStages(stages, index, frame) && res;
+}
+
+
+bool retrieveStaged(VideoCaptureType* vc, FrameType& frame, int flag, size_t index, const std::vector<FrameStage*>& stages) {
+	bool res = vc->retrieve(frame, flag);
+
+	return processStages(stages, index, frame) && res;
+}
 
 
 void openCameras(std::vector<int> camIds, int apiPreference) {
@@ -21,12 +142,20 @@ void openCameras(std::vector<int> camIds, int apiPreference) {
 	do {
 		std::vector<std::future<bool> > futures;
 		for (int i = 0; i < nbDevs; i++) {
-			if (gVidCaps[i]->status() == CamStatus::CAM_STATUS_CLOSED) {
+			if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_CLOSED) {
 				int id = camIds[i];
-				futures.emplace_back(pThread_pool->EnqueueJob(openfunc, gVidCaps[i], id, apiPreference));
+				futures.emplace_back(pThread_pool->EnqueueJob(openfunc, gSlots[i].capture, id, apiPreference));
 			}
 		}
 
+		// the cameras open in parallel, so the first pass takes as long as the slowest one.
+		for (size_t i = 0; i < futures.size(); i++) {
+			futures[i].wait();
+		}
+		gOpenPassDone.store(true);
+		if (!gKeepCamOpening)
+			break;
+
 		// keep trying to open each camera in every [waitFor] sec.
 		std::this_thread::sleep_for(std::chrono::milliseconds(waitFor));
 	} while (gKeepCamOpening);
@@ -40,8 +169,8 @@ void openFile(std::vector<std::string> filenames) {
 	// open the video files
 	std::vector<std::future<bool> > futures;
 	for (size_t i = 0; i < nbFiles; i++) {
-		if (gVidCaps[i]->status() == CamStatus::CAM_STATUS_CLOSED) {;
-			futures.emplace_back(pThread_pool->EnqueueJob(openfunc, gVidCaps[i], filenames[i]));
+		if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_CLOSED) {;
+			futures.emplace_back(pThread_pool->EnqueueJob(openfunc, gSlots[i].capture, filenames[i]));
 		}
 	}
 }
@@ -50,17 +179,33 @@ void openFile(std::vector<std::string> filenames) {
 MultiVideoCapture::MultiVideoCapture(bool verbose) {
 	mCameraIds.clear();
 	mApiPreference = -1;
-	mResolutions.clear();
-	mFpses.clear();
 
 	mApiPreference = -1;
 	mVerbose = verbose;
 	mRetryOpening = false;
+
+	mFilenames.clear();
+	mPlaybackMode = PlaybackMode::PLAYBACK_OFF;
+	mPlaybackDepth = 8;
+
+	mGovernorOn = false;
+
+	mScheduleOn = false;
+
+	mArenaFrames = 0;
+
+	mDedupMode = DedupMode::DEDUP_OFF;
+	mRawPattern = BayerPattern::BAYER_NONE;
 }
 
 
 MultiVideoCapture::~MultiVideoCapture() {
 	release();
+
+	if (gCapsCache) {
+		delete gCapsCache;
+		gCapsCache = NULL;
+	}
 }
 
 
@@ -82,8 +227,9 @@ void MultiVideoCapture::open(int index, int apiPreference, bool retry) {
 void MultiVideoCapture::open(const std::vector<std::string>& filenames) {
 	this->resize(filenames.size());
 	mCameraIds.clear();
+	mFilenames = filenames;
 
-	pThread_pool = new ThreadPool::ThreadPool(gVidCaps.size() * 2 + 4);
+	pThread_pool = new ThreadPool::ThreadPool(gSlots.size() * 2 + 4);
 
 	mRetryOpening = false;
 	gKeepCamOpening.store(mRetryOpening ? true : false);
@@ -100,6 +246,17 @@ void MultiVideoCapture::open(const std::vector<std::string>& filenames) {
 	if (mVerbose) {
 		std::cout << "one of the cameras is open!" << std::endl;
 	}
+
+	applyReplay();
+	if (mArenaFrames > 0) {
+		startArena();
+	}
+	if (mPlaybackMode != PlaybackMode::PLAYBACK_OFF) {
+		startPlayback();
+	}
+	if (mScheduleOn) {
+		startScheduler();
+	}
 }
 
 
@@ -111,16 +268,18 @@ void MultiVideoCapture::open(std::vector<int> indices, bool retry) {
 void MultiVideoCapture::open(std::vector<int> cameraIds, int apiPreference, bool retry) {
 	this->resize(cameraIds.size());
 	mCameraIds = cameraIds;
+	mFilenames.clear();
 
-	pThread_pool = new ThreadPool::ThreadPool(gVidCaps.size() * 2 + 4);
+	pThread_pool = new ThreadPool::ThreadPool(gSlots.size() * 2 + 4);
 
 	mApiPreference = apiPreference;
 	mRetryOpening = retry;
 	gKeepCamOpening.store(mRetryOpening ? true : false);
+	gOpenPassDone.store(false);
 
 	pThread_pool->EnqueueJob(openCameras, cameraIds, mApiPreference);
 
-	while (!isAnyOpened()) {
+	while (!isAnyOpened() || !gOpenPassDone) {
 		if (mVerbose) {
 			std::cout << ".";
 		}
@@ -130,6 +289,27 @@ void MultiVideoCapture::open(std::vector<int> cameraIds, int apiPreference, bool
 	if (mVerbose) {
 		std::cout << "one of the cameras is open!" << std::endl;
 	}
+
+	if (mArenaFrames > 0) {
+		startArena();
+	}
+	if (mScheduleOn) {
+		startScheduler();
+	}
+}
+
+
+void MultiVideoCapture::open(std::vector<int> cameraIds, int apiPreference, cv::Size resolution, float fps, bool retry) {
+	this->resize(cameraIds.size());
+
+	// known devices are opened straight in this mode
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		gSlots[i].resolution = resolution;
+		gSlots[i].fps = fps;
+		gSlots[i].capture->setTarget(resolution, fps);
+	}
+
+	this->open(cameraIds, apiPreference, retry);
 }
 
 
@@ -138,13 +318,30 @@ void MultiVideoCapture::release() {
 	gKeepCamOpening.store(false);
 	mApiPreference = -1;
 
-	const int nbDevs = (int)gVidCaps.size();
+	// stop decoding ahead before the thread pool is gone
+	if (gPlayback) {
+		delete gPlayback;
+		gPlayback = NULL;
+	}
+
+	if (gGovernor) {
+		delete gGovernor;
+		gGovernor = NULL;
+	}
+
+	// the workers read the captures released below
+	if (gScheduler) {
+		delete gScheduler;
+		gScheduler = NULL;
+	}
+
+	const int nbDevs = (int)gSlots.size();
 	void (VideoCaptureType::*releasefunc)() = &VideoCaptureType::release;
 	std::vector<std::future<void> > futures;
 
 	for (int i = 0; i < nbDevs; i++) {
-		if (gVidCaps[i]->status() != CamStatus::CAM_STATUS_CLOSED) {
-			futures.emplace_back(pThread_pool->EnqueueJob(releasefunc, gVidCaps[i]));
+		if (gSlots[i].capture->status() != CamStatus::CAM_STATUS_CLOSED) {
+			futures.emplace_back(pThread_pool->EnqueueJob(releasefunc, gSlots[i].capture));
 		}
 	}
 
@@ -154,20 +351,30 @@ void MultiVideoCapture::release() {
 	}
 
 	if (pThread_pool) {
-		delete[] pThread_pool;
+		delete pThread_pool;
 		pThread_pool = NULL;
 	}
 
 	// release instances of VideoCapture from memory
-	for (auto vc : gVidCaps) {
-		delete[] vc;
+	for (auto& slot : gSlots) {
+		delete slot.capture;
+	}
+	gSlots.clear();
+
+	// frames still held by the caller keep their slots until they are released
+	if (gArena) {
+		gArena->retire();
+		gArena = NULL;
+	}
+
+	if (gCapsCache) {
+		gCapsCache->save();
 	}
-	gVidCaps.clear();
 }
 
 
 bool MultiVideoCapture::isOpened(int cameraNum) const {
-	if (gVidCaps[cameraNum]->isOpened() == true)
+	if (gSlots[cameraNum].capture->isOpened() == true)
 		return true;
 	else
 		return false;
@@ -185,8 +392,8 @@ bool MultiVideoCapture::isOpened(bool all) const {
 
 
 bool MultiVideoCapture::isAnyOpened() const {
-	for (int i = 0; i < (int)gVidCaps.size(); i++) {
-		if (gVidCaps[i]->isOpened() == true) {
+	for (int i = 0; i < (int)gSlots.size(); i++) {
+		if (gSlots[i].capture->isOpened() == true) {
 			return true;
 		}
 	}
@@ -196,8 +403,8 @@ bool MultiVideoCapture::isAnyOpened() const {
 
 
 bool MultiVideoCapture::isAllOpened() const {
-	for (int i = 0; i < (int)gVidCaps.size(); i++) {
-		if (gVidCaps[i]->isOpened() == false) {
+	for (int i = 0; i < (int)gSlots.size(); i++) {
+		if (gSlots[i].capture->isOpened() == false) {
 			return false;
 		}
 	}
@@ -207,18 +414,31 @@ bool MultiVideoCapture::isAllOpened() const {
 
 
 bool MultiVideoCapture::grab() {
-	const size_t nbDevs = gVidCaps.size();
+	MVC_TRACE_SCOPE("mvc.grab");
+	if (gScheduler) {
+		return false;	// the scheduler grabs on its own, readLatest() gets the frames
+	}
+	SyncClaim claim(gSlots.size());
+	if (!claim.held()) {
+		return false;	// an async read uses the cameras
+	}
+	if (gPlayback) {
+		return gPlayback->grab();
+	}
+
+	const size_t nbDevs = gSlots.size();
 
 	std::vector<std::future<bool> > futures;
 	bool (VideoCaptureType::*grabfunc)() = &VideoCaptureType::grab;
 
 	for (int i = 0; i < nbDevs; i++) {
-		if (gVidCaps[i]->status() == CamStatus::CAM_STATUS_OPENED) {
-			futures.emplace_back(pThread_pool->EnqueueJob(grabfunc, gVidCaps[i]));
+		if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_OPENED || gSlots[i].capture->isReplaying()) {
+			futures.emplace_back(pThread_pool->EnqueueJob(grabfunc, gSlots[i].capture));
 		}
 	}
 
 	// wait until all jobs are done.
+	MVC_TRACE_SCOPE("mvc.wait");
 	bool status = false;
 	for (int i = 0; i < futures.size(); i++) {
 		futures[i].wait();
@@ -229,27 +449,85 @@ bool MultiVideoCapture::grab() {
 }
 
 
+bool MultiVideoCapture::grab(LazyFrameSet& frames, int flag) {
+	MVC_TRACE_SCOPE("mvc.grab");
+	frames.release();	// the stages end the previous cycle first
+	if (gScheduler)
+		return false;
+
+	const size_t nbDevs = gSlots.size();
+	SyncClaim claim(nbDevs);
+	if (!claim.held())
+		return false;
+	if (gPlayback) {
+		// the playback decodes ahead anyway, the whole set is retrieved at once
+		bool status = gPlayback->grab();
+		claim.release();	// the fetch claims the cameras again
+		frames.latch(this, std::vector<char>(nbDevs, status ? 1 : 0), flag);
+		frames.fetchAll();
+		return status;
+	}
+
+	std::vector<std::future<bool> > futures;
+	std::vector<size_t> indices;
+	bool (VideoCaptureType::*grabfunc)() = &VideoCaptureType::grab;
+
+	for (size_t i = 0; i < nbDevs; i++) {
+		if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_OPENED || gSlots[i].capture->isReplaying()) {
+			futures.emplace_back(pThread_pool->EnqueueJob(grabfunc, gSlots[i].capture));
+			indices.push_back(i);
+		}
+	}
+
+	// wait until all jobs are done.
+	MVC_TRACE_SCOPE("mvc.wait");
+	std::vector<char> grabbed(nbDevs, 0);
+	bool status = false;
+	for (size_t i = 0; i < futures.size(); i++) {
+		futures[i].wait();
+		grabbed[indices[i]] = futures[i].get() ? 1 : 0;
+		status = status || grabbed[indices[i]];
+	}
+	frames.latch(this, grabbed, flag);
+
+	return status;
+}
+
+
 bool MultiVideoCapture::retrieve(std::vector<FrameType>& frames, int flag) {
-	const size_t nbDevs = gVidCaps.size();
+	MVC_TRACE_SCOPE("mvc.retrieve");
+	if (gScheduler) {
+		return false;
+	}
+	SyncClaim claim(gSlots.size());
+	if (!claim.held()) {
+		return false;
+	}
+	if (gPlayback) {
+		return gPlayback->retrieve(frames) && runStages(frames);
+	}
+
+	const size_t nbDevs = gSlots.size();
 	if (nbDevs != frames.size()) {
 		frames.resize(nbDevs);
 	}
 
 	std::vector<std::future<bool> > futures;
-	bool (VideoCaptureType::* retrievefunc)(FrameType&, int) = &VideoCaptureType::retrieve;
 
-	for (int i = 0; i < nbDevs; i++) {
-		if (gVidCaps[i]->status() == CamStatus::CAM_STATUS_OPENED) {
-			futures.emplace_back(pThread_pool->EnqueueJob(retrievefunc, gVidCaps[i], std::ref(frames[i]), flag));
+	for (size_t i = 0; i < nbDevs; i++) {
+		if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_OPENED) {
+			futures.emplace_back(pThread_pool->EnqueueJob(retrieveStaged, gSlots[i].capture, std::ref(frames[i]), flag, i, std::cref(mStages)));
 		}
 	}
 
 	// wait until all jobs are done.
+	MVC_TRACE_SCOPE("mvc.wait");
 	bool status = false;
 	for (int i = 0; i < futures.size(); i++) {
 		futures[i].wait();
 		status = status || futures[i].get();
 	}
+	endStageCycle();
 
 	return status;
 }
@@ -263,48 +541,184 @@ MultiVideoCapture& MultiVideoCapture::operator >> (std::vector<FrameType>& frame
 
 
 bool MultiVideoCapture::read(std::vector<FrameType>& frames) {
-	const int nbDevs = (int)gVidCaps.size();
-	if (nbDevs != frames.size())
-		frames.resize(nbDevs);
+	MVC_TRACE_SCOPE("mvc.read");
+	if (gScheduler) {
+		return readLatest(frames);
+	}
+	SyncClaim claim(gSlots.size());
+	if (!claim.held()) {
+		return false;
+	}
+	if (gPlayback) {
+		return gPlayback->read(frames) && runStages(frames);
+	}
 
 	std::vector<std::future<bool> > futures;
-	bool (VideoCaptureType::*readfunc)(FrameType&) = &VideoCaptureType::read;
-
-	for (int i = 0; i < nbDevs; i++) {
-		if (gVidCaps[i]->status() == CamStatus::CAM_STATUS_OPENED) {
-			futures.emplace_back(pThread_pool->EnqueueJob(readfunc, gVidCaps[i], std::ref(frames[i])));
-		}
-		else
-			frames[i].release();
+	for (size_t i : readTargets(frames)) {
+		futures.emplace_back(pThread_pool->EnqueueJob(readStaged, gSlots[i].capture, std::ref(frames[i]), i, std::cref(mStages)));
 	}
 
 	// wait until all jobs are done.
+	MVC_TRACE_SCOPE("mvc.wait");
 	bool status = false;
 	for (int i = 0; i < futures.size(); i++) {
 		futures[i].wait();
 		status = status || futures[i].get();
 	}
+	endStageCycle();
 
 	return status;
 }
 
 
+bool MultiVideoCapture::readAsync(std::vector<FrameType>& frames, CaptureCallback done) {
+	const size_t nbDevs = gSlots.size();
+	if (pThread_pool == NULL || gScheduler)
+		return false;
+
+	std::vector<size_t> all(nbDevs);
+	for (size_t i = 0; i < nbDevs; i++) {
+		all[i] = i;
+	}
+	if (!claimAsync(all, nbDevs))
+		return false;
+
+	if (gPlayback) {
+		// one job, the decoders of the playback are the other threads
+		pThread_pool->Post([this, &frames, all, done]() {
+			bool status = false;
+			try {
+				status = gPlayback->read(frames);
+				for (size_t i = 0; i < frames.size(); i++) {
+					processStages(mStages, i, frames[i]);
+				}
+				endStageCycle();
+			}
+			catch (...) {
+				status = false;
+				reportAsyncError();
+			}
+			releaseAsync(all);
+			complete(done, status);
+		});
+		return true;
+	}
+
+	std::vector<size_t> targets = readTargets(frames);
+	if (targets.empty()) {
+		endStageCycle();
+		releaseAsync(all);
+		complete(done, false);
+		return true;
+	}
+
+	std::shared_ptr<AsyncRead> state = std::make_shared<AsyncRead>();
+	state->remaining = (int)targets.size();
+	state->status = false;
+	state->failed = false;
+	state->cameras = all;
+	state->done = done;
+	for (size_t i : targets) {
+		VideoCaptureType* vc = gSlots[i].capture;
+		FrameType* frame = &frames[i];
+		pThread_pool->Post([this, vc, frame, i, state]() {
+			// a throwing camera or stage fails the read, the claim is released all the same
+			try {
+				if (readStaged(vc, *frame, i, mStages))
+					state->status = true;
+			}
+			catch (...) {
+				state->failed = true;
+				reportAsyncError();
+			}
+			if (--state->remaining == 0) {
+				try {
+					endStageCycle();
+				}
+				catch (...) {
+					state->failed = true;
+					reportAsyncError();
+				}
+				releaseAsync(state->cameras);	// before the callback, which may read again
+				complete(state->done, state->status && !state->failed);
+			}
+		});
+	}
+
+	return true;
+}
+
+
+bool MultiVideoCapture::readAsync(size_t camera, FrameType& frame, CaptureCallback done) {
+	const size_t nbDevs = gSlots.size();
+	if (pThread_pool == NULL || gPlayback || gScheduler || camera >= nbDevs)
+		return false;
+	if (!claimAsync(std::vector<size_t>(1, camera), nbDevs))
+		return false;
+
+	VideoCaptureType* vc = gSlots[camera].capture;
+	if (vc->status() != CamStatus::CAM_STATUS_OPENED && !vc->isReplaying()) {
+		frame.release();
+		releaseAsync(std::vector<size_t>(1, camera));
+		complete(done, false);
+		return true;
+	}
+
+	// the stages process the frame, their cycle is left to the frame set reads
+	pThread_pool->Post([this, vc, &frame, camera, done]() {
+		bool status = false;
+		try {
+			status = readStaged(vc, frame, camera, mStages);
+		}
+		catch (...) {
+			reportAsyncError();
+		}
+		releaseAsync(std::vector<size_t>(1, camera));
+		complete(done, status);
+	});
+
+	return true;
+}
+
+
+void MultiVideoCapture::setExecutor(CaptureExecutor executor) {
+	mExecutor = executor;
+}
+
+
+// called from a catch block, the exception in flight is reported.
+void MultiVideoCapture::reportAsyncError() {
+	if (!mVerbose)
+		return;
+
+	try {
+		throw;
+	}
+	catch (const std::exception& e) {
+		std::cout << "async read failed: " << e.what() << std::endl;
+	}
+	catch (...) {
+		std::cout << "async read failed" << std::endl;
+	}
+}
+
+
 bool MultiVideoCapture::set(int propId, double value) {
-	return this->set(propId, std::vector<double>(gVidCaps.size(), value));
+	return this->set(propId, std::vector<double>(gSlots.size(), value));
 }
 
 
 bool MultiVideoCapture::set(int propId, std::vector<double> values) {
 	// get current settings
 	std::vector<double> prevValues(mCameraIds.size());
-	for (size_t i = 0; i < gVidCaps.size(); i++) {
-		prevValues[i] = gVidCaps[i]->get(propId);
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		prevValues[i] = gSlots[i].capture->get(propId);
 	}
 
 	std::vector<bool> results(mCameraIds.size(), false);
 
 	for (size_t i = 0; i < mCameraIds.size(); i++) {
-		results[i] = gVidCaps[i]->set(propId, values[i]);
+		results[i] = gSlots[i].capture->set(propId, values[i]);
 	}
 
 	bool res = false;
@@ -314,9 +728,9 @@ bool MultiVideoCapture::set(int propId, std::vector<double> values) {
 
 	// if setting is failed then restore settings for all devices.
 	if (res == false) {
-		for (size_t i = 0; i < gVidCaps.size(); i++) {
+		for (size_t i = 0; i < gSlots.size(); i++) {
 			if (results[i] == true) {
-				gVidCaps[i]->set(propId, prevValues[i]);
+				gSlots[i].capture->set(propId, prevValues[i]);
 			}
 		}
 	}
@@ -326,9 +740,9 @@ bool MultiVideoCapture::set(int propId, std::vector<double> values) {
 
 
 std::vector<double> MultiVideoCapture::get(int propId) const {
-	std::vector<double> res(gVidCaps.size(), -1);
-	for (size_t i = 0; i < gVidCaps.size(); i++) {
-		res[i] = gVidCaps[i]->get(propId);
+	std::vector<double> res(gSlots.size(), -1);
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		res[i] = gSlots[i].capture->get(propId);
 	}
 
 	return res;
@@ -352,41 +766,538 @@ bool MultiVideoCapture::set(int cameraId, cv::Size resolution, float fps) {
 	if (id >= mCameraIds.size())
 		return false;
 
-	if (mResolutions[id] == resolution && mFpses[id] == fps)
+	if (gSlots[id].resolution == resolution && gSlots[id].fps == fps)
 		return true;
 	else
 		gCamSetChanged.store(false);	// for terminating the thread that manages the previous setting.
 
-	mResolutions[id] = resolution;
-	mFpses[id] = fps;
+	gSlots[id].resolution = resolution;
+	gSlots[id].fps = fps;
 
-	gVidCaps[id]->set(resolution, fps);
+	gSlots[id].capture->set(resolution, fps);
 
 	return true;
 }
 
 
+bool MultiVideoCapture::setRoi(std::vector<int> cameraIds, cv::Rect roi, int decimation) {
+	bool status = true;
+	for (auto cameraId : cameraIds) {
+		int id = std::find(mCameraIds.begin(), mCameraIds.end(), cameraId) - mCameraIds.begin();
+		if (id >= mCameraIds.size()) {
+			status = false;
+			continue;
+		}
+
+		gSlots[id].roi = roi;
+		gSlots[id].decimation = decimation;
+		status = gSlots[id].capture->setRoi(roi, decimation) && status;
+	}
+
+	return status;
+}
+
+
+bool MultiVideoCapture::setCapabilityCache(const std::string& filename) {
+	if (gCapsCache == NULL) {
+		gCapsCache = new DeviceCapsCache;
+	}
+	bool status = gCapsCache->load(filename);
+
+	for (auto& slot : gSlots) {
+		slot.capture->setCapsCache(gCapsCache);
+	}
+
+	return status;
+}
+
+
+void MultiVideoCapture::setDeduplication(DedupMode mode) {
+	mDedupMode = mode;
+
+	for (auto& slot : gSlots) {
+		slot.capture->setDeduplication(mDedupMode);
+	}
+}
+
+
+void MultiVideoCapture::setRaw(BayerPattern pattern) {
+	mRawPattern = pattern;
+
+	for (auto& slot : gSlots) {
+		slot.capture->setRaw(mRawPattern);
+	}
+}
+
+
+void MultiVideoCapture::setFrameArena(size_t framesPerCamera) {
+	mArenaFrames = framesPerCamera;
+
+	// the arena is sized in open() when the cameras are not opened yet.
+	if (pThread_pool) {
+		if (gPlayback) {
+			gPlayback->stop();
+			startArena();
+			startPlayback();
+		}
+		else {
+			startArena();
+		}
+	}
+}
+
+
+ArenaStats MultiVideoCapture::arenaStats() const {
+	if (gArena == NULL)
+		return ArenaStats();
+
+	return gArena->stats();
+}
+
+
+void MultiVideoCapture::addStage(FrameStage* stage) {
+	auto add = [this, stage]() {
+		if (stage && std::find(mStages.begin(), mStages.end(), stage) == mStages.end()) {
+			mStages.push_back(stage);
+		}
+	};
+
+	// the scheduler workers run the stages on their own, they are held meanwhile
+	if (gScheduler)
+		gScheduler->exclusive(add);
+	else
+		add();
+}
+
+
+void MultiVideoCapture::removeStage(FrameStage* stage) {
+	auto remove = [this, stage]() {
+		mStages.erase(std::remove(mStages.begin(), mStages.end(), stage), mStages.end());
+	};
+
+	// once it returns, no worker is in the stage anymore
+	if (gScheduler)
+		gScheduler->exclusive(remove);
+	else
+		remove();
+}
+
+
+void MultiVideoCapture::setPlayback(PlaybackMode mode, size_t queueDepth) {
+	bool modeOnly = gPlayback && mode != PlaybackMode::PLAYBACK_OFF && queueDepth == mPlaybackDepth;
+	mPlaybackMode = mode;
+	mPlaybackDepth = queueDepth;
+
+	if (modeOnly) {
+		gPlayback->setMode(mode);
+		return;
+	}
+
+	if (gPlayback) {
+		delete gPlayback;
+		gPlayback = NULL;
+	}
+
+	// the playback starts in open() when the files are not opened yet.
+	if (mPlaybackMode != PlaybackMode::PLAYBACK_OFF && !mFilenames.empty() && pThread_pool) {
+		startPlayback();
+	}
+}
+
+
+PlaybackMode MultiVideoCapture::playback() const {
+	return mPlaybackMode;
+}
+
+
+bool MultiVideoCapture::seek(double msec) {
+	if (gPlayback) {
+		return gPlayback->seek(msec);
+	}
+
+	if (mFilenames.empty() || pThread_pool == NULL)
+		return false;
+
+	std::vector<std::future<bool> > futures;
+	bool (VideoCaptureType::*seekfunc)(double) = &VideoCaptureType::seek;
+	for (auto& slot : gSlots) {
+		futures.emplace_back(pThread_pool->EnqueueJob(seekfunc, slot.capture, msec));
+	}
+
+	// wait until all jobs are done.
+	bool status = true;
+	for (size_t i = 0; i < futures.size(); i++) {
+		futures[i].wait();
+		status = futures[i].get() && status;
+	}
+
+	return status;
+}
+
+
+void MultiVideoCapture::setReplay(const std::vector<ReplayProfile>& profiles, std::chrono::system_clock::time_point epoch) {
+	mReplayProfiles = profiles;
+	mReplayEpoch = epoch;
+
+	// the replay is applied in open() when the files are not opened yet.
+	if (!mFilenames.empty() && pThread_pool) {
+		if (gPlayback) {
+			gPlayback->stop();
+			applyReplay();
+			startPlayback();
+		}
+		else {
+			applyReplay();
+		}
+	}
+}
+
+
+void MultiVideoCapture::clearReplay() {
+	mReplayProfiles.clear();
+	for (auto& slot : gSlots) {
+		slot.capture->clearReplay();
+	}
+}
+
+
+void MultiVideoCapture::setGovernor(bool enable, const GovernorSettings& settings) {
+	mGovernorOn = enable;
+	mGovernorSettings = settings;
+
+	if (gGovernor) {
+		delete gGovernor;
+		gGovernor = NULL;
+	}
+	if (mGovernorOn && !gSlots.empty()) {
+		startGovernor();
+	}
+}
+
+
+void MultiVideoCapture::setSchedule(bool enable, const std::vector<double>& fps) {
+	mScheduleOn = enable;
+	mScheduleFps = fps;
+
+	if (gScheduler) {
+		delete gScheduler;
+		gScheduler = NULL;
+	}
+	// the scheduler starts in open() when the cameras are not opened yet.
+	if (mScheduleOn && pThread_pool) {
+		startScheduler();
+	}
+}
+
+
+bool MultiVideoCapture::readLatest(std::vector<FrameType>& frames, double timeoutMsec) {
+	MVC_TRACE_SCOPE("mvc.readLatest");
+	if (gScheduler == NULL)
+		return false;
+
+	return gScheduler->readLatest(frames, timeoutMsec, [this]() { endStageCycle(); });
+}
+
+
+bool MultiVideoCapture::setPriority(std::vector<int> cameraIds, double weight) {
+	if (weight <= 0.0)
+		return false;
+
+	bool status = true;
+	for (auto cameraId : cameraIds) {
+		int id = std::find(mCameraIds.begin(), mCameraIds.end(), cameraId) - mCameraIds.begin();
+		if (id >= mCameraIds.size()) {
+			status = false;
+			continue;
+		}
+
+		gSlots[id].priority = weight;
+		if (gGovernor) {
+			gGovernor->setWeight(id, weight);
+		}
+	}
+
+	return status;
+}
+
+
+void MultiVideoCapture::reportBacklog(const std::vector<size_t>& depths) {
+	if (gGovernor) {
+		gGovernor->reportBacklog(depths);
+	}
+}
+
+
+bool MultiVideoCapture::writeTrace(const std::string& filename) const {
+#ifdef MVC_ENABLE_TRACE
+	return Trace::write(filename);
+#else
+	return false;
+#endif
+}
+
+
+std::vector<CameraStats> MultiVideoCapture::stats() const {
+	std::vector<CameraStats> res(gSlots.size());
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		res[i] = gSlots[i].capture->stats();
+		if (gGovernor) {
+			res[i].framesSkipped = gGovernor->skipped(i);
+			res[i].rateScale = gGovernor->scale(i);
+		}
+		if (gScheduler) {
+			gScheduler->fillStats(i, res[i]);
+		}
+	}
+
+	return res;
+}
+
+
 void MultiVideoCapture::verbose(bool verbose) {
 	mVerbose = verbose;
 
-	for (auto vc : gVidCaps) {
-		vc->verbose(mVerbose);
+	for (auto& slot : gSlots) {
+		slot.capture->verbose(mVerbose);
+	}
+}
+
+
+void MultiVideoCapture::startPlayback() {
+	if (gPlayback == NULL) {
+		gPlayback = new PlaybackEngine(pThread_pool);
 	}
+	gPlayback->start(gSlots.captures(), mPlaybackMode, mPlaybackDepth);
+}
+
+
+void MultiVideoCapture::applyReplay() {
+	for (size_t i = 0; i < gSlots.size() && i < mReplayProfiles.size(); i++) {
+		gSlots[i].capture->setReplay(mReplayProfiles[i], mReplayEpoch);
+	}
+}
+
+
+void MultiVideoCapture::startArena() {
+	if (gArena) {
+		gArena->retire();
+		gArena = NULL;
+	}
+
+	if (mArenaFrames > 0) {
+		// a delivered frame of the stream per slot, after the ROI and decimation; smaller frames fit as well.
+		// one more slot per camera for the frame being retrieved, and the decoded ahead ones.
+		size_t slots = mArenaFrames + 1;
+		if (mPlaybackMode != PlaybackMode::PLAYBACK_OFF) {
+			slots += mPlaybackDepth;
+		}
+
+		std::vector<ArenaFormat> formats;
+		for (const auto& slot : gSlots) {
+			size_t bytes = slot.capture->frameBytes();
+			formats.push_back({ bytes, slots });
+
+			// the full frame a software crop is taken from
+			size_t full = slot.capture->frameBytes(false);
+			if (full != bytes)
+				formats.push_back({ full, 1 });
+		}
+
+		gArena = new FrameArena(formats);
+		if (!gArena->isReserved()) {
+			if (mVerbose) {
+				std::cout << "the frame arena could not be reserved, frames use the default allocator" << std::endl;
+			}
+			gArena->retire();
+			gArena = NULL;
+		}
+		else if (mVerbose) {
+			ArenaStats stats = gArena->stats();
+			std::cout << "frame arena: " << stats.slots << " slots, " << stats.reservedBytes / (1024 * 1024) << " MB"
+				<< (stats.hugePages ? " on huge pages" : "") << std::endl;
+		}
+	}
+
+	for (auto& slot : gSlots) {
+		slot.capture->setAllocator(gArena);
+	}
+}
+
+
+bool MultiVideoCapture::runStages(std::vector<FrameType>& frames) {
+	if (mStages.empty())
+		return true;
+
+	// the decoded frames are already queued, the stages run on the pool instead of the decoders.
+	std::vector<std::future<bool> > futures;
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (!frames[i].empty()) {
+			futures.emplace_back(pThread_pool->EnqueueJob(processStages, std::cref(mStages), i, std::ref(frames[i])));
+		}
+	}
+
+	bool status = false;
+	for (int i = 0; i < futures.size(); i++) {
+		futures[i].wait();
+		status = status || futures[i].get();
+	}
+	endStageCycle();
+
+	return status;
+}
+
+
+bool MultiVideoCapture::retrieveCameras(std::vector<FrameType>& frames, const std::vector<size_t>& cameras, int flag) {
+	MVC_TRACE_SCOPE("mvc.retrieve");
+	const size_t nbDevs = gSlots.size();
+	SyncClaim claim(nbDevs);
+	if (!claim.held())
+		return false;
+	if (nbDevs != frames.size()) {
+		frames.resize(nbDevs);
+	}
+
+	bool playback = false;
+	if (gPlayback) {
+		if (!gPlayback->retrieve(frames))
+			return false;
+		playback = true;
+	}
+
+	std::vector<std::future<bool> > futures;
+	for (size_t i : cameras) {
+		if (i >= nbDevs)
+			continue;
+		if (playback) {
+			if (!frames[i].empty())
+				futures.emplace_back(pThread_pool->EnqueueJob(processStages, std::cref(mStages), i, std::ref(frames[i])));
+		}
+		else {
+			futures.emplace_back(pThread_pool->EnqueueJob(retrieveStaged, gSlots[i].capture, std::ref(frames[i]), flag, i, std::cref(mStages)));
+		}
+	}
+
+	// wait until all jobs are done.
+	MVC_TRACE_SCOPE("mvc.wait");
+	bool status = false;
+	for (int i = 0; i < futures.size(); i++) {
+		futures[i].wait();
+		status = status || futures[i].get();
+	}
+
+	return status;
+}
+
+
+std::vector<size_t> MultiVideoCapture::readTargets(std::vector<FrameType>& frames) {
+	const size_t nbDevs = gSlots.size();
+	if (nbDevs != frames.size())
+		frames.resize(nbDevs);
+
+	if (gGovernor) {
+		float fps = 0.f;
+		for (const auto& slot : gSlots) {
+			fps = std::max(fps, slot.fps);
+		}
+		gGovernor->onRead(fps);
+	}
+
+	std::vector<size_t> targets;
+	for (size_t i = 0; i < nbDevs; i++) {
+		if (gGovernor && !gGovernor->admit(i)) {
+			frames[i].release();	// skipped to lower the capture rate of the camera
+		}
+		else if (gSlots[i].capture->status() == CamStatus::CAM_STATUS_OPENED || gSlots[i].capture->isReplaying()) {
+			targets.push_back(i);
+		}
+		else
+			frames[i].release();
+	}
+
+	return targets;
+}
+
+
+void MultiVideoCapture::complete(const CaptureCallback& done, bool status) {
+	if (!done)
+		return;
+	if (mExecutor)
+		mExecutor([done, status]() { done(status); });
+	else
+		done(status);
+}
+
+
+void MultiVideoCapture::endStageCycle() {
+	for (auto stage : mStages) {
+		stage->endCycle();
+	}
+}
+
+
+void MultiVideoCapture::startGovernor() {
+	gGovernor = new FrameRateGovernor(gSlots.size(), mGovernorSettings);
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		gGovernor->setWeight(i, gSlots[i].priority);
+	}
+}
+
+
+void MultiVideoCapture::startScheduler() {
+	if (gScheduler) {
+		delete gScheduler;
+		gScheduler = NULL;
+	}
+	if (gPlayback || gSlots.empty()) {
+		return;	// the files are decoded ahead at the pace of the consumer
+	}
+
+	// the rate asked for, else the one of the camera
+	std::vector<double> fps(gSlots.size(), 0.0);
+	for (size_t i = 0; i < gSlots.size(); i++) {
+		if (i < mScheduleFps.size() && mScheduleFps[i] > 0.0)
+			fps[i] = mScheduleFps[i];
+		else if (gSlots[i].fps > 0.f)
+			fps[i] = gSlots[i].fps;
+		else
+			fps[i] = gSlots[i].capture->get(cv::CAP_PROP_FPS);
+	}
+
+	const std::vector<FrameStage*>& stages = mStages;
+	size_t workers = std::max(1u, std::thread::hardware_concurrency());
+	gScheduler = new DeadlineScheduler(std::min(workers, gSlots.size()));
+	gScheduler->start(gSlots.captures(), fps, [&stages](size_t index, FrameType& frame) {
+		processStages(stages, index, frame);
+	});
+
+	if (mVerbose) {
+		std::cout << "deadline scheduling of " << gSlots.size() << " cameras" << std::endl;
+	}
+}
+
+
+VideoCaptureType* MultiVideoCapture::createCapture(size_t index) {
+	return new VideoCaptureType;
 }
 
 
 void MultiVideoCapture::resize(size_t size) {
-	if (gVidCaps.size() != size) {
+	if (gSlots.size() != size) {
 		release();
 
-		gVidCaps.resize(size);
+		gSlots.resize(size);
 		mCameraIds.resize(size, -1);
-		mResolutions.resize(size);
-		mFpses.resize(size);
 		for (int i = 0; i < size; i++) {
-			gVidCaps[i] = new VideoCaptureType;
-			mResolutions[i] = { (int)gVidCaps[i]->get(cv::CAP_PROP_FRAME_WIDTH), (int)gVidCaps[i]->get(cv::CAP_PROP_FRAME_HEIGHT) };
-			mFpses[i] = gVidCaps[i]->get(cv::CAP_PROP_FPS);
+			gSlots[i].capture = createCapture(i);
+			gSlots[i].capture->setCapsCache(gCapsCache);
+			gSlots[i].capture->setDeduplication(mDedupMode);
+			gSlots[i].capture->setRaw(mRawPattern);
+			gSlots[i].resolution = { (int)gSlots[i].capture->get(cv::CAP_PROP_FRAME_WIDTH), (int)gSlots[i].capture->get(cv::CAP_PROP_FRAME_HEIGHT) };
+			gSlots[i].fps = gSlots[i].capture->get(cv::CAP_PROP_FPS);
+		}
+
+		if (mGovernorOn) {
+			startGovernor();
 		}
 	}
 }
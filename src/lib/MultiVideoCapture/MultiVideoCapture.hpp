@@ -24,11 +24,33 @@
 #endif	// !FRAMETYPE_EXPORTS
 
 
+#include <functional>
 #include <iostream>
 #include <vector>
 
 #include "opencv2/opencv.hpp"
 #include "FrameType.hpp"
+#include "ReplayProfile.hpp"
+#include "CaptureStats.hpp"
+#include "GovernorSettings.hpp"
+#include "Deduplication.hpp"
+#include "FrameStage.hpp"
+
+
+class VideoCaptureType;
+class LazyFrameSet;
+
+
+enum class PlaybackMode {
+	PLAYBACK_OFF = 0,	// decode on demand in read()
+	PLAYBACK_MAX_SPEED,	// decode ahead and step as fast as the consumer reads
+	PLAYBACK_REALTIME,	// decode ahead and pace the steps by the file timestamps
+};
+
+
+typedef std::function<void(bool)> CaptureCallback;	// gets the status of the read
+typedef std::function<void(std::function<void()>)> CaptureExecutor;	// runs the callbacks of the async reads
+
 
 class MULTIVIDEOCAPTURE_EXPORTS MultiVideoCapture {
 public:
@@ -41,6 +63,7 @@ public:
 	virtual void open(const std::vector<std::string>& filenames);
 	virtual void open(std::vector<int> indices, bool retry = false);
 	virtual void open(std::vector<int> indices, int apiPreference, bool retry = false);
+	virtual void open(std::vector<int> indices, int apiPreference, cv::Size resolution, float fps, bool retry = false);
 	virtual void release();
 
 	virtual bool isOpened(int cameraNum) const;
@@ -49,20 +72,75 @@ public:
 	virtual bool isAllOpened() const;
 
 	virtual bool grab();
+	virtual bool grab(LazyFrameSet& frames, int flag = 0);	// the frames are retrieved when the consumer accesses them
 	virtual bool retrieve(std::vector<FrameType>& frames, int flag = 0);
 	virtual MultiVideoCapture& operator >> (std::vector<FrameType>& frames);
 	virtual bool read(std::vector<FrameType>& frames);
 
+	// done runs once the frames are ready, on the executor or else on the capture thread finishing last.
+	// false, and done is never called, while a read of the same camera is still running.
+	// the reads exclude each other: grab(), retrieve() and read() return false as well while
+	// an async read runs, and an async read is refused while one of them runs.
+	virtual bool readAsync(std::vector<FrameType>& frames, CaptureCallback done);
+	virtual bool readAsync(size_t camera, FrameType& frame, CaptureCallback done);
+	virtual void setExecutor(CaptureExecutor executor);	// only while no read is running
+
 	virtual bool set(int propId, double value);
 	virtual bool set(int propId, std::vector<double> values);
 	virtual std::vector<double> get(int propId) const;
 	virtual bool set(std::vector<int> cameraIds, cv::Size resolution, float fps = 30.f);
+	virtual bool setRoi(std::vector<int> cameraIds, cv::Rect roi, int decimation = 1);
+
+	virtual bool setCapabilityCache(const std::string& filename);
+	virtual void setDeduplication(DedupMode mode);
+	virtual void setRaw(BayerPattern pattern);	// frames as the sensor mosaic, see FrameType::color()
+
+	// frames held per camera by the caller, 0 to disable. The slots fit the stream of each camera after
+	// its ROI, decimation and raw mode: call it again once they change.
+	virtual void setFrameArena(size_t framesPerCamera);
+	virtual ArenaStats arenaStats() const;
+
+	virtual void addStage(FrameStage* stage);	// not owned, runs after the stages added before
+	virtual void removeStage(FrameStage* stage);
+
+	virtual void setPlayback(PlaybackMode mode, size_t queueDepth = 8);
+	virtual PlaybackMode playback() const;
+	virtual bool seek(double msec);
+
+	virtual void setReplay(const std::vector<ReplayProfile>& profiles, std::chrono::system_clock::time_point epoch = std::chrono::system_clock::time_point());
+	virtual void clearReplay();
+
+	virtual void setGovernor(bool enable, const GovernorSettings& settings = GovernorSettings());
+	virtual bool setPriority(std::vector<int> cameraIds, double weight);
+	virtual void reportBacklog(const std::vector<size_t>& depths);
+
+	// every camera is read at its own rate on worker threads, earliest deadline first.
+	// a rate of 0, or none given, keeps the one of the camera. read() returns the newest frames then.
+	virtual void setSchedule(bool enable, const std::vector<double>& fps = std::vector<double>());
+	virtual bool readLatest(std::vector<FrameType>& frames, double timeoutMsec = 1000.0);	// empty frames for the cameras without a new one
+
+	virtual std::vector<CameraStats> stats() const;
+	virtual bool writeTrace(const std::string& filename) const;	// Chrome trace of the pipeline, needs MVC_ENABLE_TRACE
 
 	virtual void verbose(bool verbose = false);
 
 protected:
+	friend class LazyFrameSet;
+
+	virtual VideoCaptureType* createCapture(size_t index);
 	virtual void resize(size_t size);
 	virtual bool set(int cameraId, cv::Size resolution, float fps = 30.f);
+	virtual void startPlayback();
+	virtual void applyReplay();
+	virtual void startGovernor();
+	virtual void startArena();
+	virtual void startScheduler();
+	virtual bool runStages(std::vector<FrameType>& frames);
+	virtual bool retrieveCameras(std::vector<FrameType>& frames, const std::vector<size_t>& cameras, int flag);	// without ending the stage cycle
+	virtual std::vector<size_t> readTargets(std::vector<FrameType>& frames);	// the cameras a read() grabs, the others are released
+	virtual void complete(const CaptureCallback& done, bool status);
+	virtual void reportAsyncError();
+	virtual void endStageCycle();
 
 protected:
 	std::vector<int> mCameraIds;
@@ -70,8 +148,27 @@ protected:
 	bool mVerbose;
 	bool mRetryOpening;
 
-	std::vector<cv::Size> mResolutions;
-	std::vector<float> mFpses;
+	std::vector<std::string> mFilenames;
+	PlaybackMode mPlaybackMode;
+	size_t mPlaybackDepth;
+
+	std::vector<ReplayProfile> mReplayProfiles;
+	std::chrono::system_clock::time_point mReplayEpoch;
+
+	bool mGovernorOn;
+	GovernorSettings mGovernorSettings;
+
+	bool mScheduleOn;
+	std::vector<double> mScheduleFps;
+
+	size_t mArenaFrames;
+
+	DedupMode mDedupMode;
+	BayerPattern mRawPattern;
+
+	std::vector<FrameStage*> mStages;
+
+	CaptureExecutor mExecutor;
 };
 
 
@@ -0,0 +1,231 @@
+#include "PlaybackEngine.hpp"
+
+#include <limits>
+#include <thread>
+
+
+PlaybackEngine::PlaybackEngine(ThreadPool::ThreadPool* pool) {
+	mPool = pool;
+	mRunning.store(false);
+	mMode = PlaybackMode::PLAYBACK_MAX_SPEED;
+	mPlayhead = -1.0;
+	mClockStarted = false;
+	mStartPosition = 0.0;
+}
+
+
+PlaybackEngine::~PlaybackEngine() {
+	stop();
+}
+
+
+void PlaybackEngine::start(const std::vector<VideoCaptureType*>& sources, PlaybackMode mode, size_t queueDepth) {
+	stop();
+
+	const size_t nbFiles = sources.size();
+	mSources = sources;
+	mMode = mode;
+	mQueues.resize(nbFiles);
+	for (size_t i = 0; i < nbFiles; i++) {
+		mQueues[i] = new FrameQueue(queueDepth);
+	}
+	mCurrent.assign(nbFiles, FrameType());
+	mPeriods.assign(nbFiles, 1000.0 / 30.0);
+	mPlayhead = -1.0;
+	mClockStarted = false;
+
+	launch();
+}
+
+
+void PlaybackEngine::stop() {
+	halt();
+
+	for (auto q : mQueues) {
+		delete q;
+	}
+	mQueues.clear();
+	mSources.clear();
+	mCurrent.clear();
+	mPeriods.clear();
+}
+
+
+bool PlaybackEngine::isRunning() const {
+	return mRunning;
+}
+
+
+bool PlaybackEngine::grab() {
+	const size_t nbFiles = mQueues.size();
+
+	// the playhead moves to the earliest frame waiting in any of the queues.
+	FrameType head;
+	std::vector<double> heads(nbFiles, -1.0);
+	double next = std::numeric_limits<double>::max();
+	for (size_t i = 0; i < nbFiles; i++) {
+		if (mQueues[i]->peek(head)) {
+			heads[i] = head.position();
+			next = std::min(next, heads[i]);
+		}
+		else if (mQueues[i]->isFinished()) {
+			mCurrent[i].release();	// the file has ended, its last frame is not repeated
+		}
+	}
+	if (next == std::numeric_limits<double>::max())
+		return false;	// every file reached its end
+
+	if (mMode == PlaybackMode::PLAYBACK_REALTIME) {
+		if (mClockStarted == false) {
+			mStartTime = std::chrono::steady_clock::now();
+			mStartPosition = next;
+			mClockStarted = true;
+		}
+		else {
+			std::chrono::duration<double, std::milli> offset(next - mStartPosition);
+			std::this_thread::sleep_until(mStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+		}
+	}
+
+	// advance the files whose next frame falls within half a frame of the playhead.
+	for (size_t i = 0; i < nbFiles; i++) {
+		if (heads[i] < 0.0 || heads[i] > next + mPeriods[i] * 0.5)
+			continue;
+
+		double last = mCurrent[i].position();
+		if (mQueues[i]->pop(mCurrent[i]) && last >= 0.0 && mCurrent[i].position() > last) {
+			mPeriods[i] = mCurrent[i].position() - last;
+		}
+	}
+	mPlayhead = next;
+
+	return true;
+}
+
+
+bool PlaybackEngine::retrieve(std::vector<FrameType>& frames) {
+	const size_t nbFiles = mCurrent.size();
+	if (nbFiles != frames.size())
+		frames.resize(nbFiles);
+
+	bool status = false;
+	for (size_t i = 0; i < nbFiles; i++) {
+		if (mCurrent[i].empty()) {
+			frames[i].release();
+		}
+		else {
+			frames[i] = mCurrent[i];	// shared, grab() pops the next frame into another buffer
+			status = true;
+		}
+	}
+
+	return status;
+}
+
+
+bool PlaybackEngine::read(std::vector<FrameType>& frames) {
+	if (grab() == false) {
+		for (auto& frame : frames) {
+			frame.release();
+		}
+		return false;
+	}
+
+	return retrieve(frames);
+}
+
+
+bool PlaybackEngine::seek(double msec) {
+	halt();
+
+	// seek all the files at once.
+	std::vector<std::future<bool> > futures;
+	bool (VideoCaptureType::*seekfunc)(double) = &VideoCaptureType::seek;
+	for (auto vc : mSources) {
+		futures.emplace_back(mPool->EnqueueJob(seekfunc, vc, msec));
+	}
+
+	bool status = true;
+	for (size_t i = 0; i < futures.size(); i++) {
+		futures[i].wait();
+		status = futures[i].get() && status;
+	}
+
+	for (auto& frame : mCurrent) {
+		frame.release();
+	}
+	mPlayhead = -1.0;
+	mClockStarted = false;
+
+	launch();
+
+	return status;
+}
+
+
+void PlaybackEngine::setMode(PlaybackMode mode) {
+	mMode = mode;
+	mClockStarted = false;
+}
+
+
+PlaybackMode PlaybackEngine::mode() const {
+	return mMode;
+}
+
+
+double PlaybackEngine::playhead() const {
+	return mPlayhead;
+}
+
+
+size_t PlaybackEngine::queued(size_t index) const {
+	if (index >= mQueues.size())
+		return 0;
+
+	return mQueues[index]->size();
+}
+
+
+void PlaybackEngine::launch() {
+	for (auto q : mQueues) {
+		q->reset();
+	}
+
+	mRunning.store(true);
+	for (size_t i = 0; i < mSources.size(); i++) {
+		mJobs.emplace_back(mPool->EnqueueJob(decodeAhead, mSources[i], mQueues[i], &mRunning));
+	}
+}
+
+
+void PlaybackEngine::halt() {
+	mRunning.store(false);
+	for (auto q : mQueues) {
+		q->close();
+	}
+
+	// wait until all the decode jobs are done.
+	for (size_t i = 0; i < mJobs.size(); i++) {
+		mJobs[i].wait();
+	}
+	mJobs.clear();
+}
+
+
+void PlaybackEngine::decodeAhead(VideoCaptureType* vc, FrameQueue* queue, std::atomic_bool* running) {
+	while (*running) {
+		// a new frame for every push, the queued ones must not share their buffers.
+		FrameType frame;
+		if (vc->read(frame) == false) {
+			if (vc->isReplaying())
+				continue;	// the replay simulates a disconnected camera
+
+			queue->finish();
+			break;
+		}
+
+		if (queue->push(frame) == false)
+			break;
+	}
+}
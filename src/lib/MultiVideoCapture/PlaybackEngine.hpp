@@ -0,0 +1,68 @@
+#ifndef PLAYBACK_ENGINE_H_
+#define PLAYBACK_ENGINE_H_
+
+
+#ifndef __cplusplus
+#  error PlaybackEngine.hpp header must be compiled as C++
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "MultiVideoCapture.hpp"
+#include "FrameQueue.hpp"
+#include "VideoCaptureType.hpp"
+#include "ThreadPool.hpp"
+
+
+/**
+ * @brief   Decodes every file ahead of the consumer and steps them along their timestamps.
+ * @note    One decode job per file keeps its queue filled on the thread pool,
+ *          grab() then advances every file whose next frame is due at the new playhead.
+ */
+class PlaybackEngine {
+public:
+	PlaybackEngine(ThreadPool::ThreadPool* pool);
+	virtual ~PlaybackEngine();
+
+	virtual void start(const std::vector<VideoCaptureType*>& sources, PlaybackMode mode, size_t queueDepth = 8);
+	virtual void stop();
+	virtual bool isRunning() const;
+
+	virtual bool grab();
+	virtual bool retrieve(std::vector<FrameType>& frames);
+	virtual bool read(std::vector<FrameType>& frames);
+	virtual bool seek(double msec);
+
+	virtual void setMode(PlaybackMode mode);
+	virtual PlaybackMode mode() const;
+	virtual double playhead() const;
+	virtual size_t queued(size_t index) const;
+
+protected:
+	virtual void launch();
+	virtual void halt();
+
+	static void decodeAhead(VideoCaptureType* vc, FrameQueue* queue, std::atomic_bool* running);
+
+protected:
+	ThreadPool::ThreadPool* mPool;
+	std::vector<VideoCaptureType*> mSources;
+	std::vector<FrameQueue*> mQueues;
+	std::vector<std::future<void> > mJobs;
+	std::atomic_bool mRunning;
+	PlaybackMode mMode;
+
+	std::vector<FrameType> mCurrent;	// last frame of each file at the playhead, empty once the file has ended
+	std::vector<double> mPeriods;	// estimated frame interval of each file [msec]
+	double mPlayhead;
+
+	bool mClockStarted;
+	double mStartPosition;
+	std::chrono::steady_clock::time_point mStartTime;
+};
+
+
+#endif // !PLAYBACK_ENGINE_H_
@@ -0,0 +1,153 @@
+#include "RectifyStage.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Trace.hpp"
+
+
+namespace {
+	const size_t POOL_BUFFERS = 4;	// per camera, more are left to the default allocator
+}
+
+
+bool RectifyCalibration::load(const std::string& filename) {
+	cv::FileStorage fs(filename, cv::FileStorage::READ);
+	if (!fs.isOpened())
+		return false;
+
+	int width = 0, height = 0;
+	fs["image_width"] >> width;
+	fs["image_height"] >> height;
+	fs["camera_matrix"] >> cameraMatrix;
+	fs["distortion_coefficients"] >> distCoeffs;
+	rectification.release();
+	projection.release();
+	if (!fs["rectification_matrix"].empty())
+		fs["rectification_matrix"] >> rectification;
+	if (!fs["projection_matrix"].empty())
+		fs["projection_matrix"] >> projection;
+	size = cv::Size(width, height);
+
+	return width > 0 && height > 0 && !cameraMatrix.empty();
+}
+
+
+RectifyStage::RectifyStage(size_t cameras, const RectifySettings& settings) {
+	mSettings = settings;
+	mRectifiers.resize(cameras);
+	mStats.resize(cameras);
+}
+
+
+RectifyStage::~RectifyStage() {
+}
+
+
+bool RectifyStage::process(size_t camera, FrameType& frame) {
+	if (camera >= mRectifiers.size() || frame.empty())
+		return true;
+
+	Rectifier* rectifier = mRectifiers[camera].get();
+	if (rectifier == NULL || frame.mat().size() != rectifier->size || frame.isRaw()) {
+		std::lock_guard<std::mutex> lock(mMtxStats);
+		mStats[camera].framesPassed++;
+		return true;
+	}
+
+	MVC_TRACE_SCOPE_ARG("rectify.remap", (int)camera);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// the rectified buffer takes the place of the frame, the captured one is the next free buffer
+	cv::Mat src = frame.mat();
+	cv::Mat dst = takeBuffer(*rectifier, src);
+	remapTiled(*rectifier, src, dst);
+	frame.setMat(dst);
+	if (rectifier->pool.size() < POOL_BUFFERS && src.isContinuous())
+		rectifier->pool.push_back(src);
+
+	double msec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::lock_guard<std::mutex> lock(mMtxStats);
+	mStats[camera].framesRectified++;
+	mStats[camera].remapMsec = msec;
+
+	return true;
+}
+
+
+bool RectifyStage::setCalibration(size_t camera, const RectifyCalibration& calibration) {
+	if (camera >= mRectifiers.size() || calibration.size.area() <= 0 || calibration.cameraMatrix.empty())
+		return false;
+
+	// without a rectification the frames are only undistorted, to the same intrinsics
+	std::unique_ptr<Rectifier> rectifier(new Rectifier());
+	rectifier->size = calibration.size;
+	cv::Mat newCameraMatrix = calibration.projection.empty() ? calibration.cameraMatrix : calibration.projection;
+	cv::initUndistortRectifyMap(calibration.cameraMatrix, calibration.distCoeffs, calibration.rectification,
+		newCameraMatrix, calibration.size, CV_16SC2, rectifier->map1, rectifier->map2);
+	if (rectifier->map1.empty())
+		return false;
+
+	mRectifiers[camera] = std::move(rectifier);
+
+	return true;
+}
+
+
+bool RectifyStage::loadCalibration(size_t camera, const std::string& filename) {
+	RectifyCalibration calibration;
+	if (!calibration.load(filename))
+		return false;
+
+	return setCalibration(camera, calibration);
+}
+
+
+void RectifyStage::clearCalibration(size_t camera) {
+	if (camera < mRectifiers.size())
+		mRectifiers[camera].reset();
+}
+
+
+RectifyStats RectifyStage::stats(size_t camera) const {
+	std::lock_guard<std::mutex> lock(mMtxStats);
+	if (camera >= mStats.size())
+		return RectifyStats();
+
+	return mStats[camera];
+}
+
+
+cv::Mat RectifyStage::takeBuffer(Rectifier& rectifier, const cv::Mat& frame) {
+	// a buffer still held by the consumer, or of another format, is skipped
+	std::vector<cv::Mat>& pool = rectifier.pool;
+	for (size_t i = 0; i < pool.size(); i++) {
+		const cv::Mat& buffer = pool[i];
+		if (buffer.u && buffer.u->refcount == 1 && buffer.size() == frame.size() && buffer.type() == frame.type()) {
+			cv::Mat res = buffer;
+			pool.erase(pool.begin() + i);
+			return res;
+		}
+	}
+
+	// the buffers of the previous formats go once nobody refers to them anymore
+	pool.erase(std::remove_if(pool.begin(), pool.end(), [&frame](const cv::Mat& buffer) {
+		return buffer.size() != frame.size() || buffer.type() != frame.type();
+	}), pool.end());
+
+	return cv::Mat(frame.size(), frame.type());
+}
+
+
+void RectifyStage::remapTiled(const Rectifier& rectifier, const cv::Mat& src, cv::Mat& dst) const {
+	// the source rows of a tile stay in the cache, the tables are read once per tile
+	const int tileWidth = std::max(1, mSettings.tile.width);
+	const int tileHeight = std::max(1, mSettings.tile.height);
+	for (int y = 0; y < dst.rows; y += tileHeight) {
+		for (int x = 0; x < dst.cols; x += tileWidth) {
+			cv::Rect tile(x, y, std::min(tileWidth, dst.cols - x), std::min(tileHeight, dst.rows - y));
+			cv::Mat out = dst(tile);
+			cv::remap(src, out, rectifier.map1(tile), rectifier.map2(tile), mSettings.interpolation, mSettings.borderMode);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef RECTIFY_STAGE_H_
+#define RECTIFY_STAGE_H_
+
+
+#ifndef __cplusplus
+#  error RectifyStage.hpp header must be compiled as C++
+#endif
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   Intrinsics of a camera, and its rectification in the rig when it is part of one.
+ * @note    rectification and projection are the R and P of cv::stereoRectify(), left empty for a
+ *          plain undistortion to cameraMatrix.
+ */
+struct MULTIVIDEOCAPTURE_EXPORTS RectifyCalibration {
+	cv::Size size;	// of the frames the calibration was done with
+	cv::Mat cameraMatrix;
+	cv::Mat distCoeffs;
+	cv::Mat rectification;
+	cv::Mat projection;
+
+	// image_width, image_height, camera_matrix, distortion_coefficients,
+	// and optionally rectification_matrix and projection_matrix.
+	bool load(const std::string& filename);
+};
+
+
+struct RectifySettings {
+	cv::Size tile = { 256, 64 };	// of the output, remapped one after the other
+	int interpolation = cv::INTER_LINEAR;
+	int borderMode = cv::BORDER_CONSTANT;
+};
+
+
+struct RectifyStats {
+	unsigned long long framesRectified = 0;
+	unsigned long long framesPassed = 0;	// no calibration, another frame size, or a raw mosaic
+	double remapMsec = 0.0;	// of the last frame
+};
+
+
+/**
+ * @brief   Stage undistorting and rectifying the frames of the calibrated cameras.
+ * @note    The fixed-point remap tables (CV_16SC2 and the interpolation weights) are built once in
+ *          setCalibration(). process() remaps tile by tile on the capture thread into a buffer of
+ *          the camera pool, which takes the place of the frame; the captured buffer goes back to
+ *          the pool. The frames of the other cameras are delivered unchanged.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS RectifyStage : public FrameStage {
+public:
+	RectifyStage(size_t cameras, const RectifySettings& settings = RectifySettings());
+	virtual ~RectifyStage();
+
+	virtual bool process(size_t camera, FrameType& frame);
+
+	// only between two reads
+	virtual bool setCalibration(size_t camera, const RectifyCalibration& calibration);
+	virtual bool loadCalibration(size_t camera, const std::string& filename);
+	virtual void clearCalibration(size_t camera);
+
+	virtual RectifyStats stats(size_t camera) const;
+
+protected:
+	struct Rectifier {
+		cv::Size size;
+		cv::Mat map1;	// CV_16SC2, integer source coordinates
+		cv::Mat map2;	// CV_16UC1, interpolation table indices
+		std::vector<cv::Mat> pool;	// output buffers
+	};
+
+	virtual cv::Mat takeBuffer(Rectifier& rectifier, const cv::Mat& frame);
+	virtual void remapTiled(const Rectifier& rectifier, const cv::Mat& src, cv::Mat& dst) const;
+
+protected:
+	RectifySettings mSettings;
+	std::vector<std::unique_ptr<Rectifier> > mRectifiers;	// NULL for a camera without calibration
+
+	mutable std::mutex mMtxStats;
+	std::vector<RectifyStats> mStats;
+};
+
+
+#endif // !RECTIFY_STAGE_H_
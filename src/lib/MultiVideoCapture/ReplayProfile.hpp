@@ -0,0 +1,27 @@
+#ifndef REPLAY_PROFILE_H_
+#define REPLAY_PROFILE_H_
+
+
+#ifndef __cplusplus
+#  error ReplayProfile.hpp header must be compiled as C++
+#endif
+
+#include <string>
+
+
+/**
+ * @brief   Per-camera settings of the simulated-clock replay of a video file.
+ * @note    Timestamps are taken from the sidecar index when there is one, otherwise
+ *          from CAP_PROP_POS_MSEC. The same seed always gives the same jitter and drops.
+ */
+struct ReplayProfile {
+	double jitterMsec = 0.0;	// timestamps are shifted uniformly within +-jitterMsec
+	double dropRate = 0.0;	// probability of losing a frame [0, 1)
+	long long disconnectAt = -1;	// frame index where the camera disconnects. -1 for never
+	long long disconnectFrames = 0;	// frames until the camera comes back
+	unsigned int seed = 0;
+	std::string indexFile;	// one timestamp [msec] per frame. "<filename>.idx" is used if empty
+};
+
+
+#endif // !REPLAY_PROFILE_H_
@@ -0,0 +1,387 @@
+#ifndef STATIC_MULTI_VIDEO_CAPTURE_H_
+#define STATIC_MULTI_VIDEO_CAPTURE_H_
+
+
+#ifndef __cplusplus
+#  error StaticMultiVideoCapture.hpp header must be compiled as C++
+#endif
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "opencv2/opencv.hpp"
+#include "FrameType.hpp"
+#include "VideoCaptureType.hpp"
+#include "AlignedAlloc.hpp"
+
+
+/**
+ * @brief   Pixel formats of StaticMultiVideoCapture, with the frame size fixed at compile time.
+ * @note    A native format is what the backends deliver, it is retrieved straight into the frame.
+ */
+template <int Width, int Height>
+struct PixelBgr24 {
+	static constexpr int width = Width;
+	static constexpr int height = Height;
+	static constexpr int type = CV_8UC3;
+	static constexpr bool native = true;
+	static constexpr size_t bytes = (size_t)Width * Height * 3;
+
+	static void convert(const cv::Mat& src, cv::Mat& dst) {
+		cv::Mat bgr = src;
+		if (src.channels() == 1)
+			cv::cvtColor(src, bgr, cv::COLOR_GRAY2BGR);
+		if (bgr.cols != Width || bgr.rows != Height)
+			cv::resize(bgr, dst, cv::Size(Width, Height));
+		else
+			bgr.copyTo(dst);
+	}
+};
+
+
+template <int Width, int Height>
+struct PixelGray8 {
+	static constexpr int width = Width;
+	static constexpr int height = Height;
+	static constexpr int type = CV_8UC1;
+	static constexpr bool native = false;
+	static constexpr size_t bytes = (size_t)Width * Height;
+
+	static void convert(const cv::Mat& src, cv::Mat& dst) {
+		if (src.cols != Width || src.rows != Height) {
+			cv::Mat resized;
+			cv::resize(src, resized, cv::Size(Width, Height));
+			convert(resized, dst);
+		}
+		else if (src.channels() == 3) {
+			cv::cvtColor(src, dst, cv::COLOR_BGR2GRAY);
+		}
+		else if (src.channels() == 4) {
+			cv::cvtColor(src, dst, cv::COLOR_BGRA2GRAY);
+		}
+		else {
+			src.copyTo(dst);
+		}
+	}
+};
+
+
+/**
+ * @brief   Delivery policies of StaticMultiVideoCapture.
+ * @note    SyncDelivery grabs every camera on each read() and returns once all the frames are in.
+ *          LatestDelivery lets the cameras run free and read() hands over the newest frame of each,
+ *          without waiting and without copying the pixels.
+ */
+struct SyncDelivery {};
+struct LatestDelivery {};
+
+
+/**
+ * @brief   MultiVideoCapture for a fixed rig, specialized at compile time.
+ * @note    Every camera has its own capture thread and its own cache-line aligned lane.
+ *          The per-frame calls are qualified with the concrete Capture type, so they are
+ *          not dispatched through the vtables, and the frame buffers are allocated once
+ *          at the PixelFormat size and reused.
+ */
+template <size_t N, class PixelFormat, class DeliveryPolicy = SyncDelivery, class Capture = VideoCaptureType>
+class StaticMultiVideoCapture final {
+	static_assert(N > 0, "a rig has at least one camera");
+
+public:
+	typedef std::array<FrameType, N> Frames;
+
+	static constexpr size_t cameras = N;
+	static constexpr size_t frameBytes = PixelFormat::bytes;
+	static constexpr size_t rigBytes = N * PixelFormat::bytes;
+
+	StaticMultiVideoCapture(bool verbose = false) {
+		mRunning.store(false);
+		mCycle = 0;
+		mPending = 0;
+		mTarget = NULL;
+		mVerbose = verbose;
+		for (auto& lane : mLanes) {
+			lane.fresh = false;
+			lane.capture.verbose(verbose);
+		}
+	}
+
+	~StaticMultiVideoCapture() {
+		release();
+	}
+
+	static void* operator new(size_t size) {
+		void* ptr = alignedMalloc(size, currentNumaNode());
+		if (ptr == NULL)
+			throw std::bad_alloc();
+		return ptr;
+	}
+
+	static void operator delete(void* ptr) {
+		alignedFree(ptr);
+	}
+
+	// to configure the sources before open()
+	Capture& capture(size_t i) {
+		return mLanes[i].capture;
+	}
+
+	bool open(const std::array<int, N>& cameraIds, int apiPreference = -1, float fps = 30.f) {
+		release();
+
+		std::array<std::thread, N> openers;
+		for (size_t i = 0; i < N; i++) {
+			openers[i] = std::thread([this, i, &cameraIds, apiPreference, fps]() {
+				Capture& vc = mLanes[i].capture;
+				vc.Capture::setTarget(cv::Size(PixelFormat::width, PixelFormat::height), fps);
+				try {
+					vc.Capture::open(cameraIds[i], apiPreference);
+				}
+				catch (const std::exception& e) {
+					if (mVerbose) {
+						std::lock_guard<std::mutex> lock(mMtxCycle);
+						std::cout << e.what() << std::endl;
+					}
+				}
+			});
+		}
+		for (auto& opener : openers) {
+			opener.join();
+		}
+
+		return start();
+	}
+
+	bool open(const std::array<std::string, N>& filenames) {
+		release();
+
+		std::array<std::thread, N> openers;
+		for (size_t i = 0; i < N; i++) {
+			openers[i] = std::thread([this, i, &filenames]() {
+				Capture& vc = mLanes[i].capture;
+				try {
+					vc.Capture::open(filenames[i]);
+				}
+				catch (const std::exception& e) {
+					// the lane stays closed, start() refuses the rig
+					vc.Capture::release();
+					if (mVerbose) {
+						std::lock_guard<std::mutex> lock(mMtxCycle);
+						std::cout << e.what() << std::endl;
+					}
+				}
+			});
+		}
+		for (auto& opener : openers) {
+			opener.join();
+		}
+
+		return start();
+	}
+
+	void release() {
+		if (mRunning.load()) {
+			{
+				std::lock_guard<std::mutex> lock(mMtxCycle);
+				mRunning.store(false);
+			}
+			mCvStart.notify_all();
+			for (auto& lane : mLanes) {
+				if (lane.worker.joinable())
+					lane.worker.join();
+			}
+		}
+
+		for (auto& lane : mLanes) {
+			lane.capture.Capture::release();
+			lane.fresh = false;
+		}
+	}
+
+	bool isAllOpened() const {
+		for (const auto& lane : mLanes) {
+			if (!lane.capture.Capture::isOpened())
+				return false;
+		}
+		return true;
+	}
+
+	bool read(Frames& frames) {
+		return read(frames, DeliveryPolicy());
+	}
+
+	StaticMultiVideoCapture& operator >> (Frames& frames) {
+		read(frames);
+
+		return *this;
+	}
+
+	std::array<CameraStats, N> stats() const {
+		std::array<CameraStats, N> res;
+		for (size_t i = 0; i < N; i++) {
+			res[i] = mLanes[i].capture.Capture::stats();
+		}
+		return res;
+	}
+
+	void verbose(bool verbose = false) {
+		mVerbose = verbose;
+		for (auto& lane : mLanes) {
+			lane.capture.verbose(verbose);
+		}
+	}
+
+private:
+	StaticMultiVideoCapture(const StaticMultiVideoCapture&);
+	StaticMultiVideoCapture& operator=(const StaticMultiVideoCapture&);
+
+	bool start() {
+		if (!isAllOpened()) {
+			if (mVerbose) {
+				std::cout << "not every camera of the rig is open" << std::endl;
+			}
+			release();
+			return false;
+		}
+
+		for (auto& lane : mLanes) {
+			lane.back.FrameType::mat().create(PixelFormat::height, PixelFormat::width, PixelFormat::type);
+			lane.ready.FrameType::mat().create(PixelFormat::height, PixelFormat::width, PixelFormat::type);
+		}
+
+		mRunning.store(true);
+		for (size_t i = 0; i < N; i++) {
+			mLanes[i].worker = std::thread([this, i]() { run(i, DeliveryPolicy()); });
+		}
+
+		return true;
+	}
+
+	// grabs and retrieves camera i into the frame, in the pixel format of the rig.
+	bool captureInto(size_t i, FrameType& frame) {
+		Lane& lane = mLanes[i];
+		if (!lane.capture.Capture::grab())
+			return false;
+
+		if (PixelFormat::native) {
+			if (!lane.capture.Capture::retrieve(frame))
+				return false;
+
+			const cv::Mat& mat = frame.FrameType::mat();
+			if (mat.cols == PixelFormat::width && mat.rows == PixelFormat::height && mat.type() == PixelFormat::type)
+				return true;
+
+			// the camera could not be set to the rig format
+			std::swap(lane.raw, frame);
+		}
+		else if (!lane.capture.Capture::retrieve(lane.raw)) {
+			return false;
+		}
+
+		PixelFormat::convert(lane.raw.FrameType::mat(), frame.FrameType::mat());
+		frame.FrameType::setTimestamp(lane.raw.FrameType::timestamp());
+		frame.FrameType::setPosition(lane.raw.FrameType::position());
+		frame.FrameType::setBayer(BayerPattern::BAYER_NONE);
+
+		return true;
+	}
+
+	void run(size_t i, SyncDelivery) {
+		unsigned long long seen = 0;
+		std::unique_lock<std::mutex> lock(mMtxCycle);
+		while (true) {
+			mCvStart.wait(lock, [this, &seen]() { return mCycle != seen || !mRunning.load(); });
+			if (!mRunning.load())
+				return;
+			seen = mCycle;
+			FrameType& frame = (*mTarget)[i];
+			lock.unlock();
+
+			if (!captureInto(i, frame))
+				frame.FrameType::mat().release();
+
+			lock.lock();
+			if (--mPending == 0)
+				mCvDone.notify_one();
+		}
+	}
+
+	void run(size_t i, LatestDelivery) {
+		Lane& lane = mLanes[i];
+		while (mRunning.load(std::memory_order_relaxed)) {
+			if (!captureInto(i, lane.back)) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(lane.mtx);
+			std::swap(lane.back, lane.ready);
+			lane.fresh = true;
+		}
+	}
+
+	bool read(Frames& frames, SyncDelivery) {
+		if (!mRunning.load())
+			return false;
+
+		std::unique_lock<std::mutex> lock(mMtxCycle);
+		mTarget = &frames;
+		mPending = N;
+		mCycle++;
+		mCvStart.notify_all();
+		mCvDone.wait(lock, [this]() { return mPending == 0; });
+		mTarget = NULL;
+		lock.unlock();
+
+		for (const auto& frame : frames) {
+			if (frame.FrameType::empty())
+				return false;
+		}
+		return true;
+	}
+
+	bool read(Frames& frames, LatestDelivery) {
+		bool all = mRunning.load();
+		for (size_t i = 0; i < N; i++) {
+			Lane& lane = mLanes[i];
+			{
+				// the frame handed over last time becomes the next ready buffer
+				std::lock_guard<std::mutex> lock(lane.mtx);
+				if (lane.fresh) {
+					std::swap(lane.ready, frames[i]);
+					lane.fresh = false;
+				}
+			}
+			all = all && !frames[i].FrameType::empty();
+		}
+		return all;
+	}
+
+private:
+	struct alignas(CACHE_LINE_SIZE) Lane {
+		Capture capture;
+		FrameType raw;	// before the conversion to the rig format
+		FrameType back;	// being captured, LatestDelivery only
+		FrameType ready;	// newest frame not handed over yet
+		bool fresh;
+		std::mutex mtx;
+		std::thread worker;
+	};
+
+	std::array<Lane, N> mLanes;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<bool> mRunning;
+	std::mutex mMtxCycle;
+	std::condition_variable mCvStart;
+	std::condition_variable mCvDone;
+	unsigned long long mCycle;
+	size_t mPending;
+	Frames* mTarget;
+	bool mVerbose;
+};
+
+
+#endif // !STATIC_MULTI_VIDEO_CAPTURE_H_
@@ -0,0 +1,154 @@
+#include "TensorStage.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "AlignedAlloc.hpp"
+#include "Trace.hpp"
+
+
+TensorStage::TensorStage(size_t cameras, const TensorLayout& layout) {
+	mCameras = cameras;
+	mTensor[0] = NULL;
+	mTensor[1] = NULL;
+	setLayout(layout);
+}
+
+
+TensorStage::~TensorStage() {
+	alignedFree(mTensor[0]);
+	alignedFree(mTensor[1]);
+}
+
+
+bool TensorStage::process(size_t camera, FrameType& frame) {
+	if (camera >= mCameras || !frame.isChanged())
+		return true;	// an unchanged frame keeps the previous slice
+
+	cv::Mat src = frame.color();	// a raw frame is demosaiced once, for the consumer as well
+	if (src.depth() != CV_8U || (src.channels() != 1 && src.channels() != 3 && src.channels() != 4))
+		return true;	// not converted
+
+	MVC_TRACE_SCOPE_ARG("tensor.convert", (int)camera);
+	if (src.size() == mLayout.size) {
+		convert(src, slice(mBack, camera));
+	}
+	else {
+		cv::resize(src, mScaled[camera], mLayout.size, 0, 0, mLayout.interpolation);
+		convert(mScaled[camera], slice(mBack, camera));
+	}
+	mWritten[camera] = 1;
+
+	return true;
+}
+
+
+void TensorStage::endCycle() {
+	int front = mBack ^ 1;
+	for (size_t i = 0; i < mCameras; i++) {
+		if (!mWritten[i])
+			std::memcpy(slice(mBack, i), slice(front, i), mSliceFloats * sizeof(float));
+		mFresh[i] = mWritten[i];
+		mWritten[i] = 0;
+	}
+	mBack = front;
+}
+
+
+cv::Mat TensorStage::tensor() const {
+	int sizes[] = { (int)mCameras, 3, mLayout.size.height, mLayout.size.width };
+	return cv::Mat(4, sizes, CV_32F, mTensor[mBack ^ 1]);
+}
+
+
+const float* TensorStage::data() const {
+	return mTensor[mBack ^ 1];
+}
+
+
+bool TensorStage::isFresh(size_t camera) const {
+	return camera < mCameras && mFresh[camera];
+}
+
+
+void TensorStage::setLayout(const TensorLayout& layout) {
+	mLayout = layout;
+	mLayout.size.width = std::max(1, mLayout.size.width);
+	mLayout.size.height = std::max(1, mLayout.size.height);
+
+	// (v * scale - mean) / stddev as a single multiply-add per value
+	for (int c = 0; c < 3; c++) {
+		double stddev = mLayout.stddev[c] != 0.0 ? mLayout.stddev[c] : 1.0;
+		mGain[c] = (float)(mLayout.scale / stddev);
+		mOffset[c] = (float)(-mLayout.mean[c] / stddev);
+	}
+
+	mSliceFloats = (size_t)3 * mLayout.size.area();
+	for (int i = 0; i < 2; i++) {
+		alignedFree(mTensor[i]);
+		size_t bytes = std::max<size_t>(1, mCameras * mSliceFloats * sizeof(float));
+		mTensor[i] = static_cast<float*>(alignedMalloc(bytes));
+		if (mTensor[i])
+			std::memset(mTensor[i], 0, bytes);
+	}
+	mBack = 0;
+	mWritten.assign(mCameras, 0);
+	mFresh.assign(mCameras, 0);
+	mScaled.resize(mCameras);
+}
+
+
+TensorLayout TensorStage::layout() const {
+	return mLayout;
+}
+
+
+float* TensorStage::slice(int buffer, size_t camera) const {
+	return mTensor[buffer] + camera * mSliceFloats;
+}
+
+
+void TensorStage::convert(const cv::Mat& src, float* dst) const {
+	const int width = src.cols;
+	const size_t plane = (size_t)src.rows * src.cols;
+	const int cn = src.channels();
+
+	// source channel of each tensor channel
+	const int c0 = cn == 1 ? 0 : (mLayout.swapRB ? 2 : 0);
+	const int c1 = cn == 1 ? 0 : 1;
+	const int c2 = cn == 1 ? 0 : (mLayout.swapRB ? 0 : 2);
+	const float g0 = mGain[0], g1 = mGain[1], g2 = mGain[2];
+	const float o0 = mOffset[0], o1 = mOffset[1], o2 = mOffset[2];
+
+	// one pass over the pixels: split, convert and normalize.
+	// the branch is per row, so the inner loops have constant strides and vectorize.
+	for (int y = 0; y < src.rows; y++) {
+		const uchar* s = src.ptr<uchar>(y);
+		float* p0 = dst + (size_t)y * width;
+		float* p1 = p0 + plane;
+		float* p2 = p1 + plane;
+
+		if (cn == 3) {
+			for (int x = 0; x < width; x++) {
+				p0[x] = s[3 * x + c0] * g0 + o0;
+				p1[x] = s[3 * x + c1] * g1 + o1;
+				p2[x] = s[3 * x + c2] * g2 + o2;
+			}
+		}
+		else if (cn == 4) {
+			for (int x = 0; x < width; x++) {
+				p0[x] = s[4 * x + c0] * g0 + o0;
+				p1[x] = s[4 * x + c1] * g1 + o1;
+				p2[x] = s[4 * x + c2] * g2 + o2;
+			}
+		}
+		else {
+			for (int x = 0; x < width; x++) {
+				float v = s[x];
+				p0[x] = v * g0 + o0;
+				p1[x] = v * g1 + o1;
+				p2[x] = v * g2 + o2;
+			}
+		}
+	}
+}
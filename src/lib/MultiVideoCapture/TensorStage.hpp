@@ -0,0 +1,71 @@
+#ifndef TENSOR_STAGE_H_
+#define TENSOR_STAGE_H_
+
+
+#ifndef __cplusplus
+#  error TensorStage.hpp header must be compiled as C++
+#endif
+
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "FrameStage.hpp"
+
+
+/**
+ * @brief   Input of the network: every camera becomes a 3 x height x width float image of the batch.
+ * @note    A pixel value v becomes (v * scale - mean) / stddev, per channel in the tensor order.
+ */
+struct TensorLayout {
+	cv::Size size = { 224, 224 };
+	bool swapRB = true;	// RGB tensors from the BGR frames
+	double scale = 1.0 / 255.0;
+	cv::Scalar mean = cv::Scalar(0.0, 0.0, 0.0);
+	cv::Scalar stddev = cv::Scalar(1.0, 1.0, 1.0);
+	int interpolation = cv::INTER_LINEAR;
+};
+
+
+/**
+ * @brief   Stage writing all the cameras into one NCHW float batch, ready for a DNN.
+ * @note    Every capture thread converts its frame straight into its slice of the back tensor,
+ *          the channel split and the normalization in a single pass after the resize.
+ *          endCycle() swaps the tensors, a camera without a frame in the cycle keeps its previous
+ *          slice. The frames themselves are delivered unchanged.
+ */
+class MULTIVIDEOCAPTURE_EXPORTS TensorStage : public FrameStage {
+public:
+	TensorStage(size_t cameras, const TensorLayout& layout = TensorLayout());
+	virtual ~TensorStage();
+
+	virtual bool process(size_t camera, FrameType& frame);
+	virtual void endCycle();
+
+	virtual cv::Mat tensor() const;	// N x 3 x H x W CV_32F, valid until the read() after the next one starts
+	virtual const float* data() const;
+	virtual bool isFresh(size_t camera) const;	// the slice of the camera was written by the last read()
+
+	virtual void setLayout(const TensorLayout& layout);	// only between two reads
+	virtual TensorLayout layout() const;
+
+protected:
+	virtual float* slice(int buffer, size_t camera) const;
+	virtual void convert(const cv::Mat& src, float* dst) const;
+
+protected:
+	TensorLayout mLayout;
+	size_t mCameras;
+	size_t mSliceFloats;	// 3 x H x W
+
+	float* mTensor[2];
+	int mBack;	// tensor written by the capture threads
+	std::vector<char> mWritten;	// per camera, in the current cycle
+	std::vector<char> mFresh;	// per camera, in the front tensor
+	std::vector<cv::Mat> mScaled;	// per camera, the resized frame
+
+	float mGain[3];	// per tensor channel
+	float mOffset[3];
+};
+
+
+#endif // !TENSOR_STAGE_H_
@@ -12,6 +12,8 @@
 #include <thread>
 #include <vector>
 
+#include "Trace.hpp"
+
 
 namespace ThreadPool {
 	/**
@@ -30,6 +32,9 @@ namespace ThreadPool {
 		std::future<typename std::result_of<F(Args...)>::type> EnqueueJob(
 			F&& f, Args&&... args);
 
+		// 결과를 기다리지 않는 job 을 추가한다. future 를 만들지 않는다.
+		void Post(std::function<void()> job);
+
 	private:
 		// 총 Worker 쓰레드의 개수.
 		size_t num_threads_;
@@ -49,7 +54,7 @@ namespace ThreadPool {
 	};
 
 
-	ThreadPool::ThreadPool(size_t num_threads)
+	inline ThreadPool::ThreadPool(size_t num_threads)
 		: num_threads_(num_threads), stop_all(false) {
 		worker_threads_.reserve(num_threads_);
 		for (size_t i = 0; i < num_threads_; ++i) {
@@ -57,7 +62,8 @@ namespace ThreadPool {
 		}
 	}
 
-	void ThreadPool::WorkerThread() {
+	inline void ThreadPool::WorkerThread() {
+		MVC_TRACE_THREAD_NAME("pool worker");
 		while (true) {
 			std::unique_lock<std::mutex> lock(m_job_q_);
 			cv_job_q_.wait(lock, [this]() { return !this->jobs_.empty() || stop_all; });
@@ -75,7 +81,7 @@ namespace ThreadPool {
 		}
 	}
 
-	ThreadPool::~ThreadPool() {
+	inline ThreadPool::~ThreadPool() {
 		stop_all = true;
 		cv_job_q_.notify_all();
 
@@ -84,6 +90,27 @@ namespace ThreadPool {
 		}
 	}
 
+	inline void ThreadPool::Post(std::function<void()> job) {
+		if (stop_all) {
+			throw std::runtime_error("ThreadPool 사용 중지됨");
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_job_q_);
+#ifdef MVC_ENABLE_TRACE
+			int64_t queued = Trace::now();
+			jobs_.push([job, queued]() {
+				Trace::span("pool.queue", queued, Trace::now());
+				MVC_TRACE_SCOPE("pool.job");
+				job();
+			});
+#else
+			jobs_.push(std::move(job));
+#endif
+		}
+		cv_job_q_.notify_one();
+	}
+
 	template <class F, class... Args>
 	std::future<typename std::result_of<F(Args...)>::type> ThreadPool::EnqueueJob(
 		F&& f, Args&&... args) {
@@ -97,7 +124,17 @@ namespace ThreadPool {
 		std::future<return_type> job_result_future = job->get_future();
 		{
 			std::lock_guard<std::mutex> lock(m_job_q_);
+#ifdef MVC_ENABLE_TRACE
+			// 큐에서 기다린 시간과 실행 시간을 기록한다.
+			int64_t queued = Trace::now();
+			jobs_.push([job, queued]() {
+				Trace::span("pool.queue", queued, Trace::now());
+				MVC_TRACE_SCOPE("pool.job");
+				(*job)();
+			});
+#else
 			jobs_.push([job]() { (*job)(); });
+#endif
 		}
 		cv_job_q_.notify_one();
 
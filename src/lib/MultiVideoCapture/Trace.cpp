@@ -0,0 +1,138 @@
+#include "Trace.hpp"
+
+#ifdef MVC_ENABLE_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+namespace {
+	struct TraceEvent {
+		const char* name;
+		int64_t start;
+		int64_t end;
+		int arg;
+	};
+
+
+	// written by its thread only, read by write().
+	struct TraceBuffer {
+		static const size_t CAPACITY = 1 << 16;
+
+		TraceBuffer(int tid) : events(CAPACITY), written(0), tid(tid), name(NULL) {}
+
+		std::vector<TraceEvent> events;
+		std::atomic<uint64_t> written;
+		int tid;
+		std::atomic<const char*> name;
+	};
+
+
+	std::mutex gMtxBuffers;	// only taken when a thread records its first event, and by write()
+	std::vector<std::unique_ptr<TraceBuffer> > gBuffers;	// kept after their threads exit
+	const std::chrono::steady_clock::time_point gEpoch = std::chrono::steady_clock::now();
+
+
+	TraceBuffer* threadBuffer() {
+		thread_local TraceBuffer* buffer = NULL;
+		if (buffer == NULL) {
+			std::lock_guard<std::mutex> lock(gMtxBuffers);
+			gBuffers.emplace_back(new TraceBuffer((int)gBuffers.size() + 1));
+			buffer = gBuffers.back().get();
+		}
+		return buffer;
+	}
+
+
+	void writeString(std::ostream& os, const char* str) {
+		os << '"';
+		for (const char* c = str; *c; c++) {
+			if (*c == '"' || *c == '\\')
+				os << '\\';
+			os << *c;
+		}
+		os << '"';
+	}
+}
+
+
+int64_t Trace::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gEpoch).count();
+}
+
+
+void Trace::span(const char* name, int64_t start, int64_t end, int arg) {
+	TraceBuffer* buffer = threadBuffer();
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[index % TraceBuffer::CAPACITY];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	event.arg = arg;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+
+void Trace::threadName(const char* name) {
+	threadBuffer()->name.store(name);
+}
+
+
+bool Trace::write(const std::string& filename) {
+	std::ofstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lock(gMtxBuffers);
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	for (const auto& buffer : gBuffers) {
+		const char* name = buffer->name.load();
+		if (name) {
+			file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+			writeString(file, name);
+			file << "}}";
+			first = false;
+		}
+
+		// copy the ring, then drop what the thread overwrote meanwhile
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t begin = written > TraceBuffer::CAPACITY ? written - TraceBuffer::CAPACITY : 0;
+		std::vector<TraceEvent> events;
+		events.reserve((size_t)(written - begin));
+		for (uint64_t i = begin; i < written; i++) {
+			events.push_back(buffer->events[i % TraceBuffer::CAPACITY]);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = buffer->written.load(std::memory_order_relaxed);
+		uint64_t valid = after >= TraceBuffer::CAPACITY ? after - TraceBuffer::CAPACITY + 1 : 0;
+
+		for (uint64_t i = std::max(begin, valid); i < written; i++) {
+			const TraceEvent& event = events[(size_t)(i - begin)];
+			std::ostringstream line;
+			line.setf(std::ios::fixed);
+			line.precision(3);
+			line << (first ? "" : ",") << "\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"name\":";
+			writeString(line, event.name);
+			line << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0;
+			if (event.arg >= 0)
+				line << ",\"args\":{\"camera\":" << event.arg << "}";
+			line << "}";
+			file << line.str();
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+
+	return file.good();
+}
+
+
+#endif	// MVC_ENABLE_TRACE
@@ -0,0 +1,63 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+
+#ifndef __cplusplus
+#  error Trace.hpp header must be compiled as C++
+#endif
+
+#include <string>
+
+
+/**
+ * @brief   Timeline of the capture pipeline stages, written as a Chrome trace.
+ * @note    Built only with MVC_ENABLE_TRACE, otherwise the MVC_TRACE_* macros expand to nothing.
+ *          Every thread records into its own ring buffer without locking, so the newest
+ *          events of each thread are kept. The event names must be string literals.
+ *          The file opens in chrome://tracing and in the Perfetto UI.
+ */
+#ifdef MVC_ENABLE_TRACE
+
+#include <cstdint>
+
+namespace Trace {
+	int64_t now();	// [nsec] on the steady clock
+
+	void span(const char* name, int64_t start, int64_t end, int arg = -1);
+	void threadName(const char* name);
+
+	bool write(const std::string& filename);	// events recorded so far, the buffers are kept
+}
+
+
+class TraceScope {
+public:
+	TraceScope(const char* name, int arg = -1) : mName(name), mArg(arg), mStart(Trace::now()) {}
+	~TraceScope() { Trace::span(mName, mStart, Trace::now(), mArg); }
+
+private:
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+
+	const char* mName;
+	int mArg;
+	int64_t mStart;
+};
+
+
+#  define MVC_TRACE_CONCAT_(a, b) a##b
+#  define MVC_TRACE_CONCAT(a, b) MVC_TRACE_CONCAT_(a, b)
+#  define MVC_TRACE_SCOPE(name) TraceScope MVC_TRACE_CONCAT(traceScope, __LINE__)(name)
+#  define MVC_TRACE_SCOPE_ARG(name, arg) TraceScope MVC_TRACE_CONCAT(traceScope, __LINE__)(name, arg)
+#  define MVC_TRACE_THREAD_NAME(name) Trace::threadName(name)
+
+#else
+
+#  define MVC_TRACE_SCOPE(name) ((void)0)
+#  define MVC_TRACE_SCOPE_ARG(name, arg) ((void)0)
+#  define MVC_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif	// !MVC_ENABLE_TRACE
+
+
+#endif // !TRACE_H_
@@ -1,18 +1,99 @@
 #include "VideoCaptureType.hpp"
 
 #include <chrono>
+#include <cstring>
+#include <fstream>
 #include <thread>
 
+#include "Trace.hpp"
 #include "boost/filesystem.hpp"
 namespace fs = boost::filesystem;
 
 
+namespace {
+	// copy every [step]-th pixel of every [step]-th row.
+	template <typename T>
+	void decimate(const cv::Mat& src, cv::Mat& dst, int step) {
+		for (int y = 0; y < dst.rows; y++) {
+			const T* s = src.ptr<T>(y * step);
+			T* d = dst.ptr<T>(y);
+			for (int x = 0; x < dst.cols; x++) {
+				d[x] = s[x * step];
+			}
+		}
+	}
+
+
+	// decimation of a mosaic: every [step]-th 2x2 block is kept, so the pattern stays the same.
+	template <typename T>
+	void decimateBayer(const cv::Mat& src, cv::Mat& dst, int step) {
+		for (int y = 0; y < dst.rows; y++) {
+			const T* s = src.ptr<T>((y >> 1) * 2 * step + (y & 1));
+			T* d = dst.ptr<T>(y);
+			for (int x = 0; x < dst.cols; x++) {
+				d[x] = s[(x >> 1) * 2 * step + (x & 1)];
+			}
+		}
+	}
+
+
+	// hash of 32 evenly spaced rows, 8 independent 32-bit lanes the compiler vectorizes.
+	uint64_t sampledHash(const cv::Mat& frame) {
+		const int SAMPLED_ROWS = 32;
+		const uint32_t PRIME = 16777619u;
+		uint32_t lanes[8] = { 2166136261u, 2166136261u ^ 1, 2166136261u ^ 2, 2166136261u ^ 3, 2166136261u ^ 4, 2166136261u ^ 5, 2166136261u ^ 6, 2166136261u ^ 7 };
+
+		int step = std::max(1, frame.rows / SAMPLED_ROWS);
+		size_t rowBytes = frame.cols * frame.elemSize();
+		for (int y = step / 2; y < frame.rows; y += step) {
+			const unsigned char* row = frame.ptr(y);
+			size_t x = 0;
+			for (; x + sizeof(lanes) <= rowBytes; x += sizeof(lanes)) {
+				uint32_t words[8];
+				std::memcpy(words, row + x, sizeof(words));
+				for (int k = 0; k < 8; k++) {
+					lanes[k] = (lanes[k] ^ words[k]) * PRIME;
+				}
+			}
+			for (; x < rowBytes; x++) {
+				lanes[0] = (lanes[0] ^ row[x]) * PRIME;
+			}
+		}
+
+		uint64_t hash = 14695981039346656037ULL;
+		for (int k = 0; k < 8; k++) {
+			hash = (hash ^ lanes[k]) * 1099511628211ULL;
+		}
+		return hash;
+	}
+}
+
+
 VideoCaptureType::VideoCaptureType() {
 	this->release();
 	mIsSet = false;
 	mResolution = { 640, 480 };
 	mFps = 30.f;
+	mRoi = cv::Rect();
+	mDecimation = 1;
+	mNativeRoi = false;
+	mDedup = DedupMode::DEDUP_OFF;
+	mBayer = BayerPattern::BAYER_NONE;
+	mApiPreference = -1;
+	mCapsCache = NULL;
+	mAllocator = NULL;
+	mUncheckedOpen = false;
 	mVerbose = false;
+	mGrabPosition = -1.0;
+	mReplay = false;
+	mReplayEnded = false;
+	mOpenedOnce = false;
+	mFramesDuplicate.store(0);
+	mFramesUndecoded.store(0);
+	mFramesGrabbed.store(0);
+	mFramesFailed.store(0);
+	mReconnects.store(0);
+	mGrabMsec.store(0.0);
 }
 
 
@@ -21,6 +102,20 @@ VideoCaptureType::~VideoCaptureType() {
 }
 
 
+void* VideoCaptureType::operator new(size_t size) {
+	void* ptr = alignedMalloc(size);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+
+void VideoCaptureType::operator delete(void* ptr) {
+	alignedFree(ptr);
+}
+
+
 bool VideoCaptureType::open(const std::string& filename) {
 	fs::path fName = filename;
 
@@ -78,6 +173,8 @@ bool VideoCaptureType::open(const std::string& filename) {
 	cam_status = cv::VideoCapture::open(fName.string());
 
 	if (cam_status == true) {
+		mFilename = fName.string();
+		countOpen();
 		std::lock_guard<std::mutex> lock(mMtxStatus);
 		mStatus = CamStatus::CAM_STATUS_OPENED;
 	}
@@ -138,19 +235,45 @@ bool VideoCaptureType::open(int index, int apiPreference) {
 		mStatus = CamStatus::CAM_STATUS_OPENING;
 	}
 	mCamId = index;
+	mApiPreference = apiPreference;
+	mFilename.clear();
+
+	// a device known from the cache is opened in its target mode without the probe grab.
+	DeviceMode mode;
+	bool cached = false;
+	if (mCapsCache) {
+		mCapsKey = DeviceCapsCache::deviceKey(index, apiPreference);
+		cached = mIsSet ?
+			mCapsCache->lookup(mCapsKey, mResolution, mFps, mode) :
+			mCapsCache->lookup(mCapsKey, cv::Size(), 0.0, mode);
+	}
+
 	bool cam_status = false;
-	if (apiPreference == -1)
+	if (cached)
+		cam_status = openInMode(index, apiPreference, mode);
+	else if (apiPreference == -1)
 		cam_status = cv::VideoCapture::open(index);
 	else
 		cam_status = cv::VideoCapture::open(index, apiPreference);
 
-	if (cam_status == true && cv::VideoCapture::grab() == true) {
+	if (cam_status == true && (cached || cv::VideoCapture::grab() == true)) {
+		countOpen();
+		mUncheckedOpen = cached;
 		{
 			std::lock_guard<std::mutex> lock(mMtxStatus);
 			mStatus = CamStatus::CAM_STATUS_OPENED;
 		}
-		if (mIsSet)
+		if (cached) {
+			mResolution = mode.resolution;
+			mFps = (float)mode.fps;
+			mIsSet = true;
+		}
+		else if (mIsSet)
 			this->set(mResolution, mFps);
+		else
+			recordMode();
+		applyRoi();
+		applyRaw();
 	}
 	else {
 		release();
@@ -186,20 +309,83 @@ void VideoCaptureType::release() {
 	}
 
 	cv::VideoCapture::release();
+
+	// a reopened device starts a new sequence of frames
+	mDeviceMsec = 0.0;
+	mDeviceClock = false;
+	mGrabDuplicate = false;
+	mFrameHash = 0;
+	mNewFrameTicks.store(0);
+	mGrabPending = false;
 }
 
 
 bool VideoCaptureType::grab() {
+	MVC_TRACE_SCOPE_ARG("vc.grab", mCamId);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (mReplay) {
+		bool res = grabReplay();
+		countGrab(res, start);
+		return res;
+	}
+
 	bool res = cv::VideoCapture::grab();
 	mGrabTimestamp = std::chrono::system_clock::now();
+	if (mUncheckedOpen) {
+		// the cached mode didn't work, the next open probes the device again.
+		if (res == false && mCapsCache)
+			mCapsCache->forget(mCapsKey);
+		mUncheckedOpen = false;
+	}
+	if (!mFilename.empty()) {
+		mGrabPosition = cv::VideoCapture::get(cv::CAP_PROP_POS_MSEC);
+	}
+	else if (res && mDedup != DedupMode::DEDUP_OFF) {
+		checkDeviceClock();
+	}
+	countGrab(res, start);
 
 	return res;
 }
 
 
 bool VideoCaptureType::retrieve(FrameType& frame, int flag) {
-	bool status = cv::VideoCapture::retrieve(frame.mat(), flag);
+	MVC_TRACE_SCOPE_ARG("vc.retrieve", mCamId);
+	mGrabPending = false;
+	bool dedup = mDedup != DedupMode::DEDUP_OFF && mFilename.empty() && !mReplay;
+	if (dedup && mGrabDuplicate && mDedup == DedupMode::DEDUP_SUPPRESS) {
+		// the device clock tells already, the pixels are not even copied
+		mFramesDuplicate++;
+		frame.release();
+		return false;
+	}
+
+	if (mAllocator && frame.mat().allocator != mAllocator) {
+		frame.mat().release();
+		frame.mat().allocator = mAllocator;
+	}
+
+	bool status = false;
+	if (mNativeRoi || (mRoi.empty() && mDecimation <= 1)) {
+		status = cv::VideoCapture::retrieve(frame.mat(), flag);
+	}
+	else {
+		// only the pixels in use are copied to the frame.
+		status = cv::VideoCapture::retrieve(mRaw, flag);
+		if (status)
+			cropDecimate(mRaw, frame.mat());
+		else
+			frame.mat().release();
+	}
 	frame.setTimestamp(mGrabTimestamp);
+	frame.setPosition(mGrabPosition);
+	frame.setDuplicate(false);
+	frame.setChanged(true);
+	frame.setBayer(status ? framePattern(frame.mat()) : BayerPattern::BAYER_NONE);
+
+	if (status && dedup) {
+		status = markDuplicate(frame);
+	}
 
 	return status;
 }
@@ -213,7 +399,7 @@ VideoCaptureType& VideoCaptureType::operator >> (FrameType& frame) {
 
 
 bool VideoCaptureType::read(FrameType& frame) {
-	if (cv::VideoCapture::grab() && mStatus == CamStatus::CAM_STATUS_OPENED) {
+	if (this->grab() && mStatus == CamStatus::CAM_STATUS_OPENED) {
 		this->retrieve(frame);
 	}
 	else if (mStatus == CamStatus::CAM_STATUS_SETTING) {
@@ -232,6 +418,23 @@ bool VideoCaptureType::read(FrameType& frame) {
 }
 
 
+bool VideoCaptureType::seek(double msec) {
+	if (!cv::VideoCapture::isOpened())
+		return false;
+
+	bool res = cv::VideoCapture::set(cv::CAP_PROP_POS_MSEC, msec);
+	if (res) {
+		mReplayEnded = false;
+
+		// read() marks a file as closed when it reaches the end.
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		mStatus = CamStatus::CAM_STATUS_OPENED;
+	}
+
+	return res;
+}
+
+
 bool VideoCaptureType::set(int propId, double value) {
 	CamStatus lastStatus = mStatus;
 	{
@@ -262,14 +465,20 @@ bool VideoCaptureType::set(cv::Size resolution, float fps) {
 	double oldFps = cv::VideoCapture::get(cv::CAP_PROP_FPS);
 	double oldAutofocus = cv::VideoCapture::get(cv::CAP_PROP_AUTOFOCUS);
 
-	if (resolution == oldSize && fps == oldFps)
-		return true;
-
 	if (resolution == cv::Size(-1, -1))	resolution = mResolution;
 	else	mResolution = resolution;
-	if (mFps == -1.f)	fps = mFps;
+	if (fps == -1.f)	fps = mFps;
 	else	mFps = fps;
 
+	// the camera may already run in this mode, e.g. opened from the capability cache.
+	// it is still recorded, the default mode of a device is the one the cache misses otherwise.
+	if (resolution == oldSize && fps == oldFps) {
+		recordMode();
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		mStatus = CamStatus::CAM_STATUS_OPENED;
+		return true;
+	}
+
 	// disable autofocus
 	if (oldAutofocus != 0) {
 		cv::VideoCapture::set(cv::CAP_PROP_AUTOFOCUS, 0);
@@ -287,6 +496,7 @@ bool VideoCaptureType::set(cv::Size resolution, float fps) {
 	}
 
 	if (statusSize && statusFps) {
+		recordMode();
 		{
 			std::lock_guard<std::mutex> lock(mMtxStatus);
 			mStatus = CamStatus::CAM_STATUS_OPENED;
@@ -324,6 +534,399 @@ double VideoCaptureType::get(int propId) const {
 }
 
 
+void VideoCaptureType::setReplay(const ReplayProfile& profile, std::chrono::system_clock::time_point epoch) {
+	mReplayProfile = profile;
+	mReplayEpoch = epoch;
+	mReplayRng.seed(profile.seed);
+
+	// load the sidecar index
+	mReplayIndex.clear();
+	std::string indexFile = profile.indexFile;
+	if (indexFile.empty() && !mFilename.empty()) {
+		indexFile = mFilename + ".idx";
+	}
+	std::ifstream ifs(indexFile);
+	double msec;
+	while (ifs >> msec) {
+		mReplayIndex.push_back(msec);
+	}
+
+	mReplay = true;
+	mReplayEnded = false;
+}
+
+
+void VideoCaptureType::clearReplay() {
+	mReplay = false;
+	mReplayIndex.clear();
+}
+
+
+bool VideoCaptureType::isReplaying() const {
+	return mReplay && !mReplayEnded && cv::VideoCapture::isOpened();
+}
+
+
+bool VideoCaptureType::grabReplay() {
+	bool res = cv::VideoCapture::grab();
+
+	// lost frames are decoded and thrown away so that the stream time keeps going.
+	while (res && mReplayProfile.dropRate > 0.0 && replayRandom() < mReplayProfile.dropRate) {
+		res = cv::VideoCapture::grab();
+	}
+	if (res == false) {
+		mReplayEnded = true;
+		return false;
+	}
+
+	long long frameIdx = (long long)cv::VideoCapture::get(cv::CAP_PROP_POS_FRAMES) - 1;
+	if (frameIdx >= 0 && frameIdx < (long long)mReplayIndex.size())
+		mGrabPosition = mReplayIndex[(size_t)frameIdx];
+	else
+		mGrabPosition = cv::VideoCapture::get(cv::CAP_PROP_POS_MSEC);
+
+	double jitter = 0.0;
+	if (mReplayProfile.jitterMsec > 0.0) {
+		jitter = (replayRandom() * 2.0 - 1.0) * mReplayProfile.jitterMsec;
+	}
+	std::chrono::duration<double, std::milli> offset(mGrabPosition + jitter);
+	mGrabTimestamp = mReplayEpoch + std::chrono::duration_cast<std::chrono::system_clock::duration>(offset);
+
+	// simulate the camera vanishing and coming back
+	bool disconnected = mReplayProfile.disconnectAt >= 0
+		&& frameIdx >= mReplayProfile.disconnectAt
+		&& frameIdx < mReplayProfile.disconnectAt + mReplayProfile.disconnectFrames;
+	{
+		std::lock_guard<std::mutex> lock(mMtxStatus);
+		if (disconnected)
+			mStatus = CamStatus::CAM_STATUS_CLOSED;
+		else if (mStatus == CamStatus::CAM_STATUS_CLOSED)
+			mStatus = CamStatus::CAM_STATUS_OPENED;
+	}
+
+	return !disconnected;
+}
+
+
+double VideoCaptureType::replayRandom() {
+	// std::mt19937 is fully specified, unlike the standard distributions.
+	return (double)mReplayRng() / ((double)std::mt19937::max() + 1.0);
+}
+
+
+CameraStats VideoCaptureType::stats() const {
+	CameraStats res;
+	res.framesGrabbed = mFramesGrabbed;
+	res.framesFailed = mFramesFailed;
+	res.reconnects = mReconnects;
+	res.grabMsec = mGrabMsec;
+	res.framesDuplicate = mFramesDuplicate;
+	res.framesUndecoded = mFramesUndecoded;
+
+	std::chrono::system_clock::rep ticks = mNewFrameTicks;
+	if (ticks != 0) {
+		std::chrono::system_clock::time_point newFrame{ std::chrono::system_clock::duration(ticks) };
+		res.staleMsec = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - newFrame).count();
+	}
+
+	return res;
+}
+
+
+void VideoCaptureType::setDeduplication(DedupMode mode) {
+	mDedup = mode;
+}
+
+
+DedupMode VideoCaptureType::deduplication() const {
+	return mDedup;
+}
+
+
+void VideoCaptureType::checkDeviceClock() {
+	// V4L2, MSMF and AVFoundation report the timestamp of the buffer, a repeated buffer keeps it.
+	double msec = cv::VideoCapture::get(cv::CAP_PROP_POS_MSEC);
+	mDeviceClock = msec > 0.0;
+	mGrabDuplicate = mDeviceClock && msec == mDeviceMsec;
+	mDeviceMsec = msec;
+}
+
+
+bool VideoCaptureType::markDuplicate(FrameType& frame) {
+	bool duplicate = mGrabDuplicate;
+	if (!mDeviceClock) {
+		uint64_t hash = sampledHash(frame.mat());
+		duplicate = hash == mFrameHash;
+		mFrameHash = hash;
+	}
+
+	if (!duplicate) {
+		mNewFrameTicks.store(mGrabTimestamp.time_since_epoch().count());
+		return true;
+	}
+
+	// a duplicate keeps the timestamp of the grab that delivered it first
+	mFramesDuplicate++;
+	frame.setDuplicate(true);
+	frame.setTimestamp(std::chrono::system_clock::time_point(std::chrono::system_clock::duration(mNewFrameTicks.load())));
+	if (mDedup == DedupMode::DEDUP_SUPPRESS) {
+		frame.release();
+		return false;
+	}
+
+	return true;
+}
+
+
+void VideoCaptureType::countGrab(bool status, std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	mGrabMsec.store(elapsed.count());
+	if (status) {
+		// the previous frame was never retrieved, its decoding was saved
+		if (mGrabPending)
+			mFramesUndecoded++;
+		mGrabPending = true;
+		mFramesGrabbed++;
+	}
+	else {
+		mFramesFailed++;
+	}
+}
+
+
+void VideoCaptureType::countOpen() {
+	if (mOpenedOnce)
+		mReconnects++;
+	mOpenedOnce = true;
+}
+
+
+void VideoCaptureType::setTarget(cv::Size resolution, float fps) {
+	mResolution = resolution;
+	mFps = fps;
+	mIsSet = true;
+}
+
+
+void VideoCaptureType::setCapsCache(DeviceCapsCache* cache) {
+	mCapsCache = cache;
+}
+
+
+void VideoCaptureType::setAllocator(cv::MatAllocator* allocator) {
+	mAllocator = allocator;
+	mRaw.release();
+	mRaw.allocator = allocator;
+}
+
+
+size_t VideoCaptureType::frameBytes(bool cropped) const {
+	// the stream as the backend delivers it, get() only returns the target mode
+	cv::Size size((int)cv::VideoCapture::get(cv::CAP_PROP_FRAME_WIDTH), (int)cv::VideoCapture::get(cv::CAP_PROP_FRAME_HEIGHT));
+	if (size.area() <= 0)
+		size = mResolution;	// not opened yet
+
+	bool raw = mBayer != BayerPattern::BAYER_NONE && mFilename.empty();
+	if (cropped && !mNativeRoi && (!mRoi.empty() || mDecimation > 1)) {
+		cv::Rect roi = cv::Rect(0, 0, size.width, size.height);
+		if (!mRoi.empty())
+			roi = roi & mRoi;
+		if (raw && mDecimation > 1)
+			size = cv::Size((roi.width / 2 + mDecimation - 1) / mDecimation * 2, (roi.height / 2 + mDecimation - 1) / mDecimation * 2);
+		else
+			size = cv::Size((roi.width + mDecimation - 1) / mDecimation, (roi.height + mDecimation - 1) / mDecimation);
+	}
+
+	// a mosaic has a single channel of up to 16 bits
+	return (size_t)size.area() * (raw ? 2 : 3);
+}
+
+
+bool VideoCaptureType::openInMode(int index, int apiPreference, const DeviceMode& mode) {
+	int api = apiPreference == -1 ? cv::CAP_ANY : apiPreference;
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+	// the backend configures the device before it starts streaming.
+	std::vector<int> params = {
+		cv::CAP_PROP_FRAME_WIDTH, mode.resolution.width,
+		cv::CAP_PROP_FRAME_HEIGHT, mode.resolution.height,
+	};
+	if (mode.fourcc != 0) {
+		params.insert(params.end(), { cv::CAP_PROP_FOURCC, mode.fourcc });
+	}
+	if (cv::VideoCapture::open(index, api, params) == false)
+		return false;
+#else
+	if (cv::VideoCapture::open(index, api) == false)
+		return false;
+
+	// streaming starts at the first grab, so the mode is still cheap to change.
+	if (mode.fourcc != 0)
+		cv::VideoCapture::set(cv::CAP_PROP_FOURCC, mode.fourcc);
+	cv::VideoCapture::set(cv::CAP_PROP_FRAME_WIDTH, mode.resolution.width);
+	cv::VideoCapture::set(cv::CAP_PROP_FRAME_HEIGHT, mode.resolution.height);
+#endif
+	cv::VideoCapture::set(cv::CAP_PROP_FPS, mode.fps);
+
+	return true;
+}
+
+
+void VideoCaptureType::recordMode() {
+	if (mCapsCache == NULL || mCapsKey.empty() || !mFilename.empty())
+		return;
+
+	DeviceMode mode;
+	mode.fourcc = (int)cv::VideoCapture::get(cv::CAP_PROP_FOURCC);
+	mode.resolution = { (int)cv::VideoCapture::get(cv::CAP_PROP_FRAME_WIDTH), (int)cv::VideoCapture::get(cv::CAP_PROP_FRAME_HEIGHT) };
+	mode.fps = cv::VideoCapture::get(cv::CAP_PROP_FPS);
+	mCapsCache->record(mCapsKey, mode);
+}
+
+
+void VideoCaptureType::setRaw(BayerPattern pattern) {
+	mBayer = pattern;
+
+	applyRaw();
+}
+
+
+BayerPattern VideoCaptureType::rawPattern() const {
+	return mBayer;
+}
+
+
+void VideoCaptureType::applyRaw() {
+	if (!mFilename.empty() || !cv::VideoCapture::isOpened())
+		return;
+
+	// V4L2, DirectShow, Aravis and XIMEA deliver the sensor data with the conversion off
+	cv::VideoCapture::set(cv::CAP_PROP_CONVERT_RGB, mBayer == BayerPattern::BAYER_NONE ? 1.0 : 0.0);
+}
+
+
+BayerPattern VideoCaptureType::framePattern(const cv::Mat& frame) const {
+	// a backend ignoring the raw mode still delivers BGR
+	if (mBayer == BayerPattern::BAYER_NONE || frame.channels() != 1)
+		return BayerPattern::BAYER_NONE;
+	if (mRoi.empty())
+		return mBayer;
+	if (mNativeRoi)
+		return shiftBayer(mBayer, mRoi.x, mRoi.y);
+
+	cv::Rect roi = mRoi & cv::Rect(0, 0, mRaw.cols, mRaw.rows);
+	return shiftBayer(mBayer, roi.x, roi.y);
+}
+
+
+bool VideoCaptureType::setRoi(cv::Rect roi, int decimation) {
+	mRoi = roi;
+	mDecimation = decimation > 1 ? decimation : 1;
+
+	applyRoi();	// the capture thread crops when the backend can't
+
+	return true;
+}
+
+
+cv::Rect VideoCaptureType::roi() const {
+	return mRoi;
+}
+
+
+int VideoCaptureType::decimation() const {
+	return mDecimation;
+}
+
+
+bool VideoCaptureType::applyRoi() {
+	// only XIMEA exposes ROI and decimation through cv::VideoCapture properties.
+	if (mApiPreference != cv::CAP_XIAPI || !cv::VideoCapture::isOpened())
+		return false;
+
+	bool wasNative = mNativeRoi;
+	mNativeRoi = false;
+	if (mRoi.empty() && mDecimation <= 1 && !wasNative)
+		return false;
+
+	cv::Rect roi = mRoi.empty() ? cv::Rect(0, 0, mResolution.width, mResolution.height) : mRoi;
+	bool status =
+		cv::VideoCapture::set(cv::CAP_PROP_XI_DECIMATION_HORIZONTAL, mDecimation) &&
+		cv::VideoCapture::set(cv::CAP_PROP_XI_DECIMATION_VERTICAL, mDecimation) &&
+		cv::VideoCapture::set(cv::CAP_PROP_XI_WIDTH, roi.width / mDecimation) &&
+		cv::VideoCapture::set(cv::CAP_PROP_XI_HEIGHT, roi.height / mDecimation) &&
+		cv::VideoCapture::set(cv::CAP_PROP_XI_OFFSET_X, roi.x / mDecimation) &&
+		cv::VideoCapture::set(cv::CAP_PROP_XI_OFFSET_Y, roi.y / mDecimation);
+
+	if (status == false) {
+		// fall back to cropping on the capture thread
+		cv::VideoCapture::set(cv::CAP_PROP_XI_DECIMATION_HORIZONTAL, 1);
+		cv::VideoCapture::set(cv::CAP_PROP_XI_DECIMATION_VERTICAL, 1);
+		cv::VideoCapture::set(cv::CAP_PROP_XI_OFFSET_X, 0);
+		cv::VideoCapture::set(cv::CAP_PROP_XI_OFFSET_Y, 0);
+		cv::VideoCapture::set(cv::CAP_PROP_XI_WIDTH, mResolution.width);
+		cv::VideoCapture::set(cv::CAP_PROP_XI_HEIGHT, mResolution.height);
+		return false;
+	}
+
+	mNativeRoi = !(mRoi.empty() && mDecimation <= 1);
+	return true;
+}
+
+
+void VideoCaptureType::cropDecimate(const cv::Mat& src, cv::Mat& dst) const {
+	MVC_TRACE_SCOPE_ARG("vc.convert", mCamId);
+	cv::Rect roi = cv::Rect(0, 0, src.cols, src.rows);
+	if (!mRoi.empty())
+		roi = roi & mRoi;
+
+	if (mDecimation <= 1) {
+		src(roi).copyTo(dst);
+		return;
+	}
+
+	cv::Mat view = src(roi);
+	if (mBayer != BayerPattern::BAYER_NONE && src.channels() == 1) {
+		// whole 2x2 blocks, a plain decimation would keep a single colour of the mosaic
+		int blocksX = (roi.width / 2 + mDecimation - 1) / mDecimation;
+		int blocksY = (roi.height / 2 + mDecimation - 1) / mDecimation;
+		dst.create(blocksY * 2, blocksX * 2, src.type());
+		if (src.elemSize() == 1)
+			decimateBayer<uchar>(view, dst, mDecimation);
+		else
+			decimateBayer<ushort>(view, dst, mDecimation);
+		return;
+	}
+
+	dst.create((roi.height + mDecimation - 1) / mDecimation, (roi.width + mDecimation - 1) / mDecimation, src.type());
+	switch (src.elemSize()) {
+	case 1:
+		decimate<uchar>(view, dst, mDecimation);
+		break;
+	case 2:
+		decimate<cv::Vec2b>(view, dst, mDecimation);
+		break;
+	case 3:
+		decimate<cv::Vec3b>(view, dst, mDecimation);
+		break;
+	case 4:
+		decimate<cv::Vec4b>(view, dst, mDecimation);
+		break;
+	default:
+		// any other pixel size is copied byte by byte
+		const size_t esz = src.elemSize();
+		for (int y = 0; y < dst.rows; y++) {
+			const uchar* s = view.ptr(y * mDecimation);
+			uchar* d = dst.ptr(y);
+			for (int x = 0; x < dst.cols; x++) {
+				std::memcpy(d + x * esz, s + x * mDecimation * esz, esz);
+			}
+		}
+		break;
+	}
+}
+
+
 void VideoCaptureType::verbose(bool verbose) {
 	mVerbose = verbose;
 }
@@ -6,10 +6,18 @@
 #  error MultiVideoCapture.hpp header must be compiled as C++
 #endif
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
+#include <random>
 
 #include "opencv2/opencv.hpp"
 #include "FrameType.hpp"
+#include "ReplayProfile.hpp"
+#include "CaptureStats.hpp"
+#include "DeviceCapsCache.hpp"
+#include "AlignedAlloc.hpp"
+#include "Deduplication.hpp"
 
 
 enum class CamStatus {
@@ -20,11 +28,20 @@ enum class CamStatus {
 };
 
 
+/**
+ * @brief   A camera or video file captured by its own jobs on the thread pool.
+ * @note    Every instance starts on its own cache lines, and keeps the per-grab fields apart from
+ *          the ones the consumer polls. It is not placed on a NUMA node: the capture jobs run on
+ *          any thread of the pool.
+ */
 class VideoCaptureType : protected cv::VideoCapture {
 public:
 	VideoCaptureType();
 	virtual ~VideoCaptureType();
 
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+
 	virtual bool open(const std::string& filename);
 	virtual bool open(int index);
 	virtual bool open(int index, int apiPreference);
@@ -37,29 +54,103 @@ public:
 	virtual bool retrieve(FrameType& frame, int flag = 0);
 	virtual VideoCaptureType& operator >> (FrameType& frame);
 	virtual bool read(FrameType& frame);
+	virtual bool seek(double msec);
 
 	virtual bool set(int propId, double value);
 	virtual bool set(cv::Size resolution = { -1, -1 }, float fps = -1.f);
 	virtual double get(int propId) const;
 
+	virtual void setTarget(cv::Size resolution, float fps);
+	virtual void setCapsCache(DeviceCapsCache* cache);
+	virtual void setAllocator(cv::MatAllocator* allocator);	// of the frame pixels, NULL for the default one
+	virtual size_t frameBytes(bool cropped = true) const;	// of a delivered frame, or of the full one before a software crop
+
+	virtual bool setRoi(cv::Rect roi = cv::Rect(), int decimation = 1);
+	virtual cv::Rect roi() const;
+	virtual int decimation() const;
+
+	virtual void setDeduplication(DedupMode mode);
+	virtual DedupMode deduplication() const;
+
+	// the frames stay the mosaic of the sensor, BAYER_NONE to let the backend convert them to BGR
+	virtual void setRaw(BayerPattern pattern);
+	virtual BayerPattern rawPattern() const;
+
+	virtual void setReplay(const ReplayProfile& profile, std::chrono::system_clock::time_point epoch = std::chrono::system_clock::time_point());
+	virtual void clearReplay();
+	virtual bool isReplaying() const;
+
+	virtual CameraStats stats() const;
 	virtual void verbose(bool verbose = false);
 
 protected:
-	int mCamId;
-	CamStatus mStatus;
-	bool mIsSet;
+	virtual void countGrab(bool status, std::chrono::steady_clock::time_point start);
+	virtual void countOpen();
+	virtual bool openInMode(int index, int apiPreference, const DeviceMode& mode);
+	virtual void recordMode();
+	virtual bool applyRoi();
+	virtual void applyRaw();
+	virtual BayerPattern framePattern(const cv::Mat& frame) const;	// of the delivered frame, after the crop
+	virtual void cropDecimate(const cv::Mat& src, cv::Mat& dst) const;
+	virtual bool grabReplay();
+	virtual void checkDeviceClock();
+	virtual bool markDuplicate(FrameType& frame);
+	virtual double replayRandom();
+
+protected:
+	// polled by the consumer thread, changed on open, release and errors.
+	alignas(CACHE_LINE_SIZE) CamStatus mStatus;
+	std::mutex mMtxStatus;
 
-	std::chrono::system_clock::time_point mGrabTimestamp;
+	// written by the capture thread on every grab.
+	alignas(CACHE_LINE_SIZE) std::chrono::system_clock::time_point mGrabTimestamp;
+	double mGrabPosition;
+	bool mUncheckedOpen;	// opened from the cache without a probe grab
+	std::atomic<unsigned long long> mFramesGrabbed;
+	std::atomic<unsigned long long> mFramesFailed;
+	std::atomic<double> mGrabMsec;
+	cv::Mat mRaw;	// full frame retrieved before cropping
+	double mDeviceMsec;	// device timestamp of the last buffer
+	bool mDeviceClock;	// the backend reports the buffer timestamps
+	bool mGrabDuplicate;	// the last grab returned the previous buffer again
+	uint64_t mFrameHash;	// sampled pixels of the last frame, without a device clock
+	std::atomic<unsigned long long> mFramesDuplicate;
+	std::atomic<std::chrono::system_clock::rep> mNewFrameTicks;	// timestamp of the last new frame
+	bool mGrabPending;	// grabbed and not retrieved yet
+	std::atomic<unsigned long long> mFramesUndecoded;
+
+	// settings, changed rarely.
+	alignas(CACHE_LINE_SIZE) int mCamId;
+	int mApiPreference;
+	bool mIsSet;
 	int mCloseCount;
 	int mCloseLimit;
 
 	cv::Size mResolution;
 	float mFps;
+	cv::Rect mRoi;	// empty for the full frame
+	int mDecimation;
+	bool mNativeRoi;	// the backend crops and decimates by itself
+	DedupMode mDedup;
+	BayerPattern mBayer;	// of the sensor, BAYER_NONE when the backend converts
 
 	bool mVerbose;
 
-	std::mutex mMtxStatus;
-	std::mutex mMtxMsg;
+	std::string mFilename;
+	DeviceCapsCache* mCapsCache;
+	cv::MatAllocator* mAllocator;
+	std::string mCapsKey;
+	bool mReplay;
+	bool mReplayEnded;
+	ReplayProfile mReplayProfile;
+	std::chrono::system_clock::time_point mReplayEpoch;
+	std::vector<double> mReplayIndex;
+	std::mt19937 mReplayRng;
+
+	bool mOpenedOnce;
+	std::atomic<unsigned long long> mReconnects;
+
+	alignas(CACHE_LINE_SIZE) std::mutex mMtxMsg;
 };
 
 